@@ -42,7 +42,9 @@ private:
     {"r12", 12}, {"r13", 13}, {"sp", 14}, {"pc", 15}
   };
   unordered_map<string, int> status_registers = {
-    {"status",0}, {"handler", 1}, {"cause", 2}
+    {"status",0}, {"handler", 1}, {"cause", 2}, {"hartid", 3},
+    {"instret", 4}, {"instreth", 5}, {"cycle", 6}, {"cycleh", 7},
+    {"branches", 8}, {"loads", 9}, {"stores", 10}, {"interrupts", 11}
   };
 
   //removes starting white spaces from string
@@ -0,0 +1,61 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+#include "emulator.hpp"
+#include "imageTemplate.hpp"
+#include "instanceScheduler.hpp"
+using namespace std;
+
+//one line of a jobs file: image [rN=value|sp=value|pc=value]... [ADDRESS=value]... [input=FILE]
+struct BatchJob{
+  uint line;
+  string image;
+  vector<pair<uint32_t, uint32_t>> registers;   //(register, value) set after reset
+  vector<pair<uint32_t, uint32_t>> words;       //(address, word) written after loading
+  string input;                                 //terminal input, read from the named file
+};
+
+//runs every job of a jobs file as its own emulator instance on a work-stealing pool
+//every distinct image is loaded once into an ImageTemplate that all of its jobs map
+//a summary line is printed as each job finishes, a total line once all of them did
+//with a quantum the jobs are time-sliced instead of run one after another, the threads steal slices of each other's jobs
+//and every job is reported once all of them are done, a job left waiting for input once its input ran out
+//is reported as blocked rather than spinning forever
+class BatchRunner{
+private:
+  EmulatorOptions options;    //common to every job
+  uint threads;
+  uint64_t quantum;           //0 runs every job to its end in one go
+  vector<BatchJob> jobs;
+  map<string, ImageTemplate*> templates;
+  std::mutex output_lock;
+  uint failed;
+
+  void parse_jobs(const string& jobs_file);
+  static BatchJob parse_job(const string& line, uint number);
+  //nullptr when the job could not be loaded, failure says why
+  Emulator* start_job(size_t index, string& failure);
+  void report_job(size_t index, Emulator* e, const string& failure, double seconds);
+  void run_job(size_t index);
+  void run_sliced();
+
+  //printable form of the captured terminal output, one line
+  static string escape(const string& s);
+
+public:
+  BatchRunner(const string& jobs_file, EmulatorOptions o, uint threads, uint64_t quantum = 0);
+  ~BatchRunner();
+
+  BatchRunner(const BatchRunner&) = delete;
+  BatchRunner& operator=(const BatchRunner&) = delete;
+
+  void run();
+  inline uint get_failed_count() const {return this->failed;}
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef BINARYIMAGE_H
+#define BINARYIMAGE_H
+
+#include <cstdint>
+
+//executable image written by the linker with -bin and mapped by the emulator
+//header, then segment_count segment entries, then the payloads
+//a payload starts at the same offset within a 4KB file page as its load address has within a guest page,
+//so whole guest pages can be mapped straight from the file
+//bytes past file_size up to file_size + zero_fill_size are zero and are not stored
+//all fields are little endian
+struct BinaryImageHeader{
+  char magic[8];
+  uint32_t version;
+  uint32_t entry;
+  uint32_t segment_count;
+  uint32_t reserved;
+};
+
+struct BinaryImageSegment{
+  uint32_t load_address;
+  uint32_t file_offset;
+  uint32_t file_size;
+  uint32_t zero_fill_size;
+};
+
+struct BinaryImageFormat{
+  static constexpr const char* MAGIC = "EMUBIN";
+  static const uint32_t VERSION = 1;
+  static const uint32_t PAGE_SIZE = 4096;
+  static const uint32_t DEFAULT_ENTRY = 0x40000000;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <unordered_map>
+#include "decodeCache.hpp"
+#include "cpuContext.hpp"
+
+class Emulator;
+typedef void (*MicroOpHandler)(Emulator* e, const DecodedInstruction& d);
+//native code for a whole block, returns the number of guest instructions it executed
+typedef uint32_t (*NativeBlock)(CpuContext* c, Emulator* e, uint8_t** pages, uint8_t* page_flags, uint32_t* device_spans);
+
+//one guest instruction of a translated block, decoded and bound to its handler
+struct MicroOp{
+  DecodedInstruction decoded;
+  MicroOpHandler handler;
+  uint32_t address;
+};
+
+//straight-line guest code from start_address up to and including the next instruction that changes the PC
+struct TranslatedBlock{
+  static const int SUCCESSORS = 2;
+
+  uint32_t start_address;
+  uint32_t end_address;     //one past the last byte of the last instruction
+  vector<MicroOp> ops;
+  bool valid;
+  uint32_t execution_count;
+  NativeBlock native;       //set once the JIT compiled the block
+  bool may_idle;            //short and writes neither memory nor csrs, a loop of it alone may be a wait loop
+
+  //blocks that followed this one, so the next block is found without a lookup
+  uint32_t successor_addresses[SUCCESSORS];
+  TranslatedBlock* successors[SUCCESSORS];
+  int next_successor_slot;
+
+  TranslatedBlock(uint32_t a){
+    this->start_address = a;
+    this->end_address = a;
+    this->valid = true;
+    this->execution_count = 0;
+    this->native = nullptr;
+    this->may_idle = false;
+    for(int i = 0 ; i < SUCCESSORS ; ++i){
+      this->successor_addresses[i] = 0;
+      this->successors[i] = nullptr;
+    }
+    this->next_successor_slot = 0;
+  }
+
+  inline TranslatedBlock* get_successor(uint32_t a) const {
+    for(int i = 0 ; i < SUCCESSORS ; ++i){
+      if(this->successors[i] != nullptr && this->successor_addresses[i] == a && this->successors[i]->valid) return this->successors[i];
+    }
+    return nullptr;
+  }
+
+  inline void chain(uint32_t a, TranslatedBlock* b){
+    this->successor_addresses[this->next_successor_slot] = a;
+    this->successors[this->next_successor_slot] = b;
+    this->next_successor_slot = (this->next_successor_slot + 1) % SUCCESSORS;
+  }
+
+  inline void unchain(){
+    for(int i = 0 ; i < SUCCESSORS ; ++i) this->successors[i] = nullptr;
+  }
+};
+
+//translated blocks keyed by start PC
+//every block is registered with the pages it covers, a store into one of them drops the overlapping blocks
+//the owning hart forwards code writes to it, see CodeWriteQueue
+//dropped blocks stay allocated until the next flush because other blocks may still be chained to them
+class BlockCache: public CodeWriteListener{
+public:
+  static const uint32_t MAX_BLOCK_LENGTH = 64;
+
+private:
+  static const size_t MAX_RETIRED_BLOCKS = 1024;
+
+  unordered_map<uint32_t, TranslatedBlock*> blocks;
+  unordered_map<uint32_t, vector<TranslatedBlock*>> blocks_by_page;
+  vector<TranslatedBlock*> retired_blocks;
+
+  void retire(TranslatedBlock* b){
+    b->valid = false;
+    this->blocks.erase(b->start_address);
+    this->retired_blocks.push_back(b);
+  }
+
+  static void remove_retired(vector<TranslatedBlock*>& page_blocks){
+    for(size_t i = 0 ; i < page_blocks.size() ; ){
+      if(!page_blocks[i]->valid){
+        page_blocks[i] = page_blocks.back();
+        page_blocks.pop_back();
+      }
+      else ++i;
+    }
+  }
+
+  //drops every chain so retired blocks are no longer reachable and can be freed
+  void flush_retired(){
+    for(auto it = this->blocks.begin() ; it != this->blocks.end() ; ++it) it->second->unchain();
+    for(auto it = this->blocks_by_page.begin() ; it != this->blocks_by_page.end() ; ++it) remove_retired(it->second);
+    for(size_t i = 0 ; i < this->retired_blocks.size() ; ++i) delete this->retired_blocks[i];
+    this->retired_blocks.clear();
+  }
+
+public:
+  BlockCache(){}
+
+  ~BlockCache(){
+    for(auto it = this->blocks.begin() ; it != this->blocks.end() ; ++it) delete it->second;
+    for(size_t i = 0 ; i < this->retired_blocks.size() ; ++i) delete this->retired_blocks[i];
+  }
+
+  BlockCache(const BlockCache&) = delete;
+  BlockCache& operator=(const BlockCache&) = delete;
+
+  inline TranslatedBlock* find(uint32_t a) const {
+    auto it = this->blocks.find(a);
+    return it == this->blocks.end() ? nullptr : it->second;
+  }
+
+  void add(TranslatedBlock* b){
+    if(this->retired_blocks.size() >= MAX_RETIRED_BLOCKS) this->flush_retired();
+    this->blocks[b->start_address] = b;
+    uint32_t last_page = (b->end_address - 1) >> Memory::PAGE_BITS;
+    for(uint32_t page = b->start_address >> Memory::PAGE_BITS ; ; ++page){
+      this->blocks_by_page[page].push_back(b);
+      if(page == last_page) break;
+    }
+  }
+
+  inline size_t get_size() const {return this->blocks.size();}
+
+  void code_written(uint32_t a, uint32_t size) override {
+    auto it = this->blocks_by_page.find(a >> Memory::PAGE_BITS);
+    if(it == this->blocks_by_page.end()) return;
+    vector<TranslatedBlock*>& page_blocks = it->second;
+    for(size_t i = 0 ; i < page_blocks.size() ; ++i){
+      TranslatedBlock* b = page_blocks[i];
+      if(b->valid && a < b->end_address && a + size > b->start_address) this->retire(b);
+    }
+    remove_retired(page_blocks);
+  }
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef CALLBACKDEVICE_H
+#define CALLBACKDEVICE_H
+
+#include <functional>
+#include "memory.hpp"
+
+//device of a program that embeds the emulator, the callback runs on every guest write into its register window
+//like the built-in devices its registers live in guest memory, the callback reads and answers through them
+class CallbackDevice: public MmioDevice{
+public:
+  typedef std::function<void(uint32_t address, uint32_t size)> Callback;
+
+private:
+  Callback written;
+
+public:
+  CallbackDevice(Memory* m, uint32_t base, uint32_t size, Callback written){
+    this->written = written;
+    m->map_device(base, size, this);
+  }
+
+  CallbackDevice(const CallbackDevice&) = delete;
+  CallbackDevice& operator=(const CallbackDevice&) = delete;
+
+  void mmio_written(uint32_t address, uint32_t size) override {
+    this->written(address, size);
+  }
+};
+
+#endif
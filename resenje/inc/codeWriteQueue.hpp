@@ -0,0 +1,68 @@
+#ifndef CODEWRITEQUEUE_H
+#define CODEWRITEQUEUE_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "memory.hpp"
+using namespace std;
+
+//code write listener of one hart, the hart's own caches are behind it
+//writes made by the hart itself reach the caches right away, writes made by other harts are queued
+//and the hart's next_event is pulled in, so they are applied between its blocks like on hardware without coherent instruction fetch
+class CodeWriteQueue: public CodeWriteListener{
+private:
+  struct CodeWrite{
+    uint32_t address;
+    uint32_t size;
+  };
+
+  vector<CodeWriteListener*> caches;
+  uint64_t* next_event;
+  std::thread::id owner;    //thread the hart runs on, none before its first run
+  std::mutex lock;
+  vector<CodeWrite> queued;
+  std::atomic<bool> has_queued;
+
+  inline void forward(uint32_t a, uint32_t size){
+    for(size_t i = 0 ; i < this->caches.size() ; ++i) this->caches[i]->code_written(a, size);
+  }
+
+public:
+  CodeWriteQueue(uint64_t* next_event){
+    this->next_event = next_event;
+    this->has_queued = false;
+  }
+
+  CodeWriteQueue(const CodeWriteQueue&) = delete;
+  CodeWriteQueue& operator=(const CodeWriteQueue&) = delete;
+
+  inline void add_cache(CodeWriteListener* l){this->caches.push_back(l);}
+  inline void set_owner(std::thread::id t){this->owner = t;}
+
+  void code_written(uint32_t a, uint32_t size) override {
+    if(this->owner == std::thread::id() || this->owner == std::this_thread::get_id()){
+      this->forward(a, size);
+      return;
+    }
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->queued.push_back({a, size});
+    this->has_queued.store(true, std::memory_order_release);
+    __atomic_store_n(this->next_event, 0, __ATOMIC_RELAXED);
+  }
+
+  //called by the owning hart between blocks
+  inline void deliver(){
+    if(!this->has_queued.load(std::memory_order_acquire)) return;
+    vector<CodeWrite> writes;
+    {
+      std::lock_guard<std::mutex> guard(this->lock);
+      writes.swap(this->queued);
+      this->has_queued.store(false, std::memory_order_relaxed);
+    }
+    for(size_t i = 0 ; i < writes.size() ; ++i) this->forward(writes[i].address, writes[i].size);
+  }
+};
+
+#endif
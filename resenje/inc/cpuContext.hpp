@@ -0,0 +1,44 @@
+#ifndef CPUCONTEXT_H
+#define CPUCONTEXT_H
+
+#include <cstdint>
+#include <cstddef>
+
+//architectural state of the emulated processor
+//layout is fixed, native code generated by the JIT addresses the fields by offset
+struct CpuContext{
+  //status bits, a set bit masks the interrupt
+  static const uint32_t STATUS_TIMER = 0x1;
+  static const uint32_t STATUS_TERMINAL = 0x2;
+  static const uint32_t STATUS_INTERRUPTS = 0x4;
+
+  //cause values
+  static const uint32_t CAUSE_TIMER = 2;
+  static const uint32_t CAUSE_TERMINAL = 3;
+  static const uint32_t CAUSE_SOFTWARE = 4;
+
+  //csrs from WRITABLE_CSRS on are read only, writes to them are ignored and reads past CSR_COUNT return 0
+  //csrs below STORED_CSRS live in status_registers, the performance counters after them are computed when read
+  static const uint32_t CSR_HARTID = 3;
+  static const uint32_t CSR_INSTRET = 4;      //retired instructions, low and high word
+  static const uint32_t CSR_INSTRETH = 5;
+  static const uint32_t CSR_CYCLE = 6;        //virtual cycles, low and high word
+  static const uint32_t CSR_CYCLEH = 7;
+  static const uint32_t CSR_BRANCHES = 8;     //low words of the event counters, in Event order
+  static const uint32_t WRITABLE_CSRS = 3;
+  static const uint32_t STORED_CSRS = 4;
+  static const uint32_t CSR_COUNT = 12;
+
+  //events counted for the counter csrs
+  //loads and stores are the memory accesses instructions make besides their own fetch, a literal read through pc is a load
+  enum Event {EVENT_BRANCH, EVENT_LOAD, EVENT_STORE, EVENT_INTERRUPT, EVENT_COUNT};
+
+  uint32_t registers[16];                 //pc is reg15, sp is reg14
+  uint32_t status_registers[STORED_CSRS]; //status, handler, cause, hartid
+  uint64_t events[EVENT_COUNT];           //taken branches, loads, stores, interrupts taken
+};
+
+static_assert(offsetof(CpuContext, registers) == 0, "JIT expects registers at offset 0");
+static_assert(offsetof(CpuContext, status_registers) == 64, "JIT expects status registers at offset 64");
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_set>
+#include "memory.hpp"
+using namespace std;
+
+class Emulator;
+
+//breakpoints and write watchpoints for --debug, driven by commands typed at a prompt or read from a script
+//breakpoints are looked up at block entry only, translation cuts blocks at them so every breakpoint starts a block
+//watchpoints flag their pages in memory, a store into a flagged page already takes the reporting slow path,
+//a store that hits a watched range stops the run at the next service point, after the block that made it
+//cores without --debug are built without any of these checks
+class Debugger: public WatchListener{
+private:
+  struct Watch{
+    uint32_t address;
+    uint32_t size;
+  };
+
+  Emulator* emulator;
+  uint64_t* next_event;     //pulled in to stop as soon as the core looks at it
+  ifstream* script;         //nullptr when commands are typed
+  istream* commands;
+  unordered_set<uint32_t> breakpoints;
+  vector<Watch> watches;
+  bool stop_requested;
+  string stop_reason;
+  bool resuming;            //the breakpoint the run stopped at does not stop it again when it continues
+  uint32_t resume_address;
+
+  void add_breakpoint(uint32_t a);
+  void flag_pages(const Watch& w, bool set);
+  void add_watch(uint32_t a, uint32_t size);
+  void remove_watch(uint32_t a);
+  void detach();
+  void print_location();
+  void print_memory(uint32_t a, uint32_t count);
+  //false once the run should continue
+  bool execute(const string& line);
+
+public:
+  //commands come from the script, or from stdin when it is empty
+  Debugger(Emulator* e, uint64_t* next_event, const string& script);
+  ~Debugger();
+
+  Debugger(const Debugger&) = delete;
+  Debugger& operator=(const Debugger&) = delete;
+
+  inline bool is_breakpoint(uint32_t a) const {return !this->breakpoints.empty() && this->breakpoints.count(a) != 0;}
+
+  //called at every block entry by the --debug cores
+  inline bool should_stop(uint32_t pc){
+    if(this->breakpoints.empty()) return false;
+    bool resumed = this->resuming && pc == this->resume_address;
+    this->resuming = false;
+    return !resumed && this->breakpoints.count(pc) != 0;
+  }
+
+  //the run stops at the next service point
+  void request_stop(const string& reason);
+  //called at every service point, stops if a stop was requested since the previous one
+  inline void service(){
+    if(this->stop_requested) this->stop(this->stop_reason);
+  }
+
+  //reads and runs commands until one continues the run
+  void stop(const string& reason);
+
+  void watched_write(uint32_t address, uint32_t size) override;
+};
+
+#endif
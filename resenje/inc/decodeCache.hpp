@@ -0,0 +1,128 @@
+#ifndef DECODECACHE_H
+#define DECODECACHE_H
+
+#include "memory.hpp"
+#include "macroOp.hpp"
+
+//one instruction word split into its fields
+//I = OC|M, II = A|B, III = C|D[11:8], IV = D[7:0], byte I is at the lowest address
+struct DecodedInstruction{
+  uint32_t raw;       //instruction word as read from memory (little endian)
+  int32_t d;          //sign extended displacement
+  uint32_t literal;   //literal carried by a macro-op
+  uint16_t handler;   //index into the handler table, byte I or the macro-op handler
+  uint8_t macro;      //MacroOp::Kind, the other fields describe the first word of the sequence
+  uint8_t words;      //instruction words covered, more than one for a macro-op
+  uint8_t opcode;
+  uint8_t mode;
+  uint8_t a;
+  uint8_t b;
+  uint8_t c;
+  bool valid;
+
+  static inline DecodedInstruction decode(uint32_t word){
+    DecodedInstruction decoded;
+    decoded.raw = word;
+    decoded.opcode = (word >> 4) & 0xF;
+    decoded.mode = word & 0xF;
+    decoded.a = (word >> 12) & 0xF;
+    decoded.b = (word >> 8) & 0xF;
+    decoded.c = (word >> 20) & 0xF;
+    int32_t d = ((word >> 8) & 0xF00) | ((word >> 24) & 0xFF);
+    decoded.d = (d << 20) >> 20;
+    decoded.literal = 0;
+    decoded.handler = word & 0xFF;
+    decoded.macro = MacroOp::NONE;
+    decoded.words = 1;
+    decoded.valid = true;
+    return decoded;
+  }
+};
+
+//decoded instructions keyed by PC, one lazily allocated array of entries per code page
+//pages that were decoded are flagged in memory, so stores into them invalidate the affected entries
+//the owning hart forwards code writes to it, see CodeWriteQueue
+class DecodeCache: public CodeWriteListener{
+private:
+  static const uint32_t ENTRIES_PER_PAGE = Memory::PAGE_SIZE / 4;
+
+  Memory* memory;
+  DecodedInstruction** decoded_pages;   //Memory::PAGE_COUNT entries, nullptr until code from the page is fetched
+  vector<uint32_t> decoded_page_numbers;
+  DecodedInstruction unaligned;         //scratch entry for fetches that are not word aligned
+
+  DecodedInstruction* allocate_page(uint32_t a){
+    DecodedInstruction* page = static_cast<DecodedInstruction*>(calloc(ENTRIES_PER_PAGE, sizeof(DecodedInstruction)));
+    if(page == nullptr) throw ExceptionAlert("Out of host memory while allocating the decode cache.");
+    this->decoded_pages[a >> Memory::PAGE_BITS] = page;
+    this->decoded_page_numbers.push_back(a >> Memory::PAGE_BITS);
+    this->memory->set_page_flags(a, Memory::PAGE_CODE);
+    return page;
+  }
+
+  //a macro-op covers the words after its first one, their page has to report writes as well
+  void fuse(DecodedInstruction& d, uint32_t a){
+    uint32_t words[MacroOp::MAX_WORDS];
+    for(uint32_t i = 0 ; i < MacroOp::MAX_WORDS ; ++i) words[i] = this->memory->read_word(a + 4 * i);
+    const MacroOpPattern* p = MacroOps::recognize(words);
+    if(p == nullptr) return;
+    d.macro = p->kind;
+    d.words = p->words;
+    d.handler = MacroOp::HANDLER_BASE + p->kind;
+    d.literal = p->literal_word != 0 ? words[p->literal_word] : 0;
+    uint32_t last = a + 4 * (p->words - 1);
+    if((last >> Memory::PAGE_BITS) != (a >> Memory::PAGE_BITS)) this->memory->set_page_flags(last, Memory::PAGE_CODE);
+  }
+
+  inline void invalidate_word(uint32_t a){
+    DecodedInstruction* page = this->decoded_pages[a >> Memory::PAGE_BITS];
+    if(page != nullptr) page[(a & Memory::PAGE_MASK) >> 2].valid = false;
+  }
+
+public:
+  DecodeCache(Memory* m){
+    this->memory = m;
+    this->decoded_pages = static_cast<DecodedInstruction**>(calloc(Memory::PAGE_COUNT, sizeof(DecodedInstruction*)));
+    if(this->decoded_pages == nullptr) throw ExceptionAlert("Out of host memory while allocating the decode cache.");
+  }
+
+  ~DecodeCache(){
+    for(size_t i = 0 ; i < this->decoded_page_numbers.size() ; ++i){
+      free(this->decoded_pages[this->decoded_page_numbers[i]]);
+    }
+    free(this->decoded_pages);
+  }
+
+  DecodeCache(const DecodeCache&) = delete;
+  DecodeCache& operator=(const DecodeCache&) = delete;
+
+  //returns the decoded instruction at address a, decoding it on a miss
+  inline const DecodedInstruction& fetch(uint32_t a){
+    //instructions are expected on word boundaries, anything else is decoded every time
+    if(a & 0x3){
+      this->unaligned = DecodedInstruction::decode(this->memory->read_word(a));
+      return this->unaligned;
+    }
+    DecodedInstruction* page = this->decoded_pages[a >> Memory::PAGE_BITS];
+    if(page == nullptr) page = this->allocate_page(a);
+    DecodedInstruction& entry = page[(a & Memory::PAGE_MASK) >> 2];
+    if(!entry.valid){
+      entry = DecodedInstruction::decode(this->memory->read_word(a));
+      this->fuse(entry, a);
+    }
+    return entry;
+  }
+
+  //a store of size bytes at address a touches at most two instruction words,
+  //along with the macro-ops that start up to MAX_WORDS - 1 words before them
+  void code_written(uint32_t a, uint32_t size) override {
+    uint32_t first = (a & ~0x3u) - 4 * (MacroOp::MAX_WORDS - 1);
+    uint32_t last = (a + size - 1) & ~0x3u;
+    for(uint32_t w = first ; ; w += 4){
+      this->invalidate_word(w);
+      if(w == last) break;
+    }
+  }
+};
+
+#endif
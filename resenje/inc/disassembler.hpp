@@ -0,0 +1,11 @@
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include <string>
+#include "decodeCache.hpp"
+using namespace std;
+
+//human readable form of one instruction, shared by the text trace and tracedump
+string describe_instruction(const DecodedInstruction& d);
+
+#endif
@@ -1,42 +1,286 @@
 #ifndef EMULATOR_H
 #define EMULATOR_H
-#include "linker.hpp"
+#include <bitset>
+#include <iostream>
+#include <fstream>
 #include <iomanip>
+#include <array>
+#include <utility>
+#include <atomic>
+#include <cstring>
+#include "exceptionAlert.hpp"
+#include "cpuContext.hpp"
+#include "memory.hpp"
+#include "decodeCache.hpp"
+#include "blockCache.hpp"
+#include "jit.hpp"
+#include "trace.hpp"
+#include "traceWriter.hpp"
+#include "terminal.hpp"
+#include "semihost.hpp"
+#include "callbackDevice.hpp"
+#include "timer.hpp"
+#include "interruptController.hpp"
+#include "codeWriteQueue.hpp"
+#include "snapshot.hpp"
+#include "hexLoader.hpp"
+#include "mappedImage.hpp"
+#include "profiler.hpp"
+#include "imageTemplate.hpp"
+#include "eventLog.hpp"
+#include "debugger.hpp"
+
+//command line selectable behaviour of the emulator
+struct EmulatorOptions{
+  enum Core {THREADED, BLOCK, JIT};
+  enum Trace {TRACE_NONE, TRACE_TEXT, TRACE_BINARY};
+  enum SnapshotTrigger {SNAPSHOT_NONE, SNAPSHOT_AT_PC, SNAPSHOT_AT_COUNT};
+
+  Core core = BLOCK;
+  Trace trace = TRACE_NONE;   //trace of every instruction, interpreted cores only
+  bool measure = false;   //report executed instructions and MIPS
+  uint repeat = 1;        //run the loaded image this many times from reset
+  uint frequency_mhz = 100;   //virtual clock, one instruction per cycle
+  bool realtime = false;      //pace virtual time to the host clock
+  SnapshotTrigger snapshot = SNAPSHOT_NONE;
+  uint64_t snapshot_at = 0;   //pc or retired instruction count, depending on the trigger
+  string snapshot_file = "emulator.snap";
+  bool restore = false;       //the input is a snapshot file, emulation resumes from it
+  bool profile = false;       //count retired instructions per pc, interpreted cores only
+  string symbol_file = "";    //linker -map output for the profile, the input name with .map when empty
+  string profile_file = "profile.txt";
+  uint harts = 1;             //guest cores, each one runs on its own host thread over the shared memory
+  string record_file = "";    //host input is logged here
+  string replay_file = "";    //input comes from this log instead of the host
+  bool skip_idle = true;      //wait loops jump ahead to the next event, block cores with one hart only
+  bool debug = false;         //breakpoints and watchpoints, the run stops at the entry point
+  string debug_script = "";   //debugger commands, typed at a prompt when empty
+  //batch jobs
+  const ImageTemplate* shared_image = nullptr;    //mapped instead of loading the input file
+  vector<pair<uint32_t, uint32_t>> register_overrides;  //(register, value) set after every reset
+  vector<pair<uint32_t, uint32_t>> memory_overrides;    //(address, word) written once after loading
+  bool detached = false;      //no host terminal, files or printing, the caller reads the results
+};
 
 class Emulator{
 private:
+  friend class JitCompiler;
+  friend struct TextTrace;
+  friend struct BinaryTrace;
+  friend struct ProfileTrace;
+  friend class Debugger;
+
+  //one handler per (opcode, mode) pair, indexed by byte I of the instruction, followed by one per macro-op
+  typedef MicroOpHandler Handler;
+  static const size_t HANDLER_COUNT = MacroOp::HANDLER_BASE + MacroOp::COUNT;
+  static const std::array<Handler, HANDLER_COUNT> handler_table;
+
+  template<uint8_t OPCODE, uint8_t MODE>
+  static void execute(Emulator* e, const DecodedInstruction& d);
+  template<uint8_t KIND>
+  static void execute_macro(Emulator* e, const DecodedInstruction& d);
+  template<size_t INDEX>
+  static constexpr Handler handler_at();
+  template<size_t... INDEX>
+  static constexpr std::array<Handler, HANDLER_COUNT> make_handler_table(std::index_sequence<INDEX...>);
+
+  EmulatorOptions options;
   ulong current_address;
-  const ulong starting_address = 0x40000000;
-  ifstream* input_file;
+  ulong starting_address;   //0x40000000 unless a binary image names another entry point
+  string input_filename;    //hex or binary image, or a snapshot when restoring
   ofstream* output_file;
-  uint32_t registers[16]={0}; //pc is reg15, sp is reg14, all registers are initialized to 0;
-  uint32_t status_registers[3]={0}; //status, handler, cause
+  CpuContext context = {}; //all registers are initialized to 0
+  uint hart_id;
+  Emulator* primary;        //hart 0 owns the memory and the devices, nullptr on hart 0 itself
+  vector<Emulator*> secondary_harts;    //harts 1 to N-1, only on hart 0
+  std::atomic<bool> stopping;           //set on hart 0 when a hart failed, every hart stops at its next event
+  string failure;                       //message of the exception that stopped a secondary hart
   bool debug; //used for printing instructions and registers in a file
+  bool running;
+  bool halted;              //executed halt since the last reset
+  uint64_t instructions_retired;
+  uint64_t next_event;      //instruction count at which the cores call service_devices, other harts pull it to 0
+  uint64_t device_event;    //next_event as the devices scheduled it, before it was cut at stop_at
+  uint64_t stop_at;         //run_for stops once this many instructions retired, NO_LIMIT otherwise
 
-  SegmentTable* emulator_segment_table;
+  static const uint64_t NO_LIMIT = UINT64_MAX;
+
+  //input is looked at every this many instructions, between them the cores only compare next_event
+  static const uint64_t DEVICE_POLL_INTERVAL = 4096;
+
+  //block looping back to itself, its state at the previous entry
+  //an entry with the same registers and no service point in between means every further iteration is the same,
+  //nothing but an event can end the loop, so virtual time jumps to the next one, see skip_to_event
+  //a loop is compared once per service interval, counted loops pay for one copy of the registers per interval
+  struct IdleLoop{
+    bool armed;               //set at every service point, cleared once a comparison failed
+    const TranslatedBlock* block;
+    uint32_t registers[16];
+    uint64_t instructions_retired;
+    uint64_t events[CpuContext::EVENT_COUNT];
+  };
+  static const size_t IDLE_MAX_LENGTH = 4;    //longest block that is watched
+  IdleLoop idle;
+  bool skip_idle;           //the option, cleared with more than one hart since others may end the loop
+
+  Memory* memory;
+  DecodeCache* decode_cache;
+  BlockCache* block_cache;
+  JitCompiler* jit;         //only created for the JIT core
+  TraceWriter* trace_writer;  //only created for the binary trace
+  bool reset_untraced;      //reset since the trace got its RESET record, written when the next run starts
+  Terminal* terminal;
+  Semihost* semihost;
+  Timer* timer;
+  InterruptController* interrupts;
+  InterruptRouter* router;  //shared by all harts
+  CodeWriteQueue* code_writes;
+  Snapshot* restored;       //only when resuming from a snapshot, owns the restored pages
+  MappedImage* image;       //only for binary images, owns the mapped pages
+  Profiler* profiler;       //only created with --profile
+  EventRecorder* recorder;  //only created with --record
+  EventReplayer* replayer;  //only created with --replay
+  Debugger* debugger;       //only created with --debug
+  vector<CallbackDevice*> devices;      //added by an embedding program
+  bool snapshot_pending;
+
+  //secondary hart sharing hart 0's memory and devices
+  Emulator(Emulator* primary, uint hart_id);
 
-  string clean_line(string l);
-  uint hex_to_int(string s);
   uint string_to_int(string s);
-  string stringify_segment(Segment * s);
-  uint32_t get_segment_value(Segment* s);
-  string number_to_binary32_string(uint i);
-  void parse_input_hex();
-  void emulate();
+  void initialize(EmulatorOptions o);
+  void load_image();
+  void run_core();
+  inline void trace_reset(){
+    if(this->reset_untraced && this->trace_writer != nullptr) this->trace_writer->reset(this->starting_address);
+    this->reset_untraced = false;
+  }
+  void run_harts();
+  void run_secondary();
+  template<class Trace> void emulate_threaded();
+  template<class Trace> void emulate_blocks();
+  TranslatedBlock* translate_block(uint32_t a);
+  static bool may_idle(const DecodedInstruction& d);
+  static bool may_idle(const TranslatedBlock* b);
+  //true once virtual time jumped, the block is not run again before the event
+  inline bool watch_idle(const TranslatedBlock* b){
+    if(this->idle.block == b && memcmp(this->idle.registers, this->context.registers, sizeof(this->idle.registers)) == 0){
+      return this->skip_to_event();
+    }
+    if(this->idle.block != nullptr){
+      this->idle.armed = false;
+      return false;
+    }
+    this->idle.block = b;
+    memcpy(this->idle.registers, this->context.registers, sizeof(this->idle.registers));
+    this->idle.instructions_retired = this->instructions_retired;
+    memcpy(this->idle.events, this->context.events, sizeof(this->idle.events));
+    return false;
+  }
+  bool skip_to_event();
+  void service_devices();
+  void end_run_for();
+  //other threads store 0 into next_event at any time, every access to it is atomic
+  inline uint64_t get_next_event() const {return __atomic_load_n(&this->next_event, __ATOMIC_RELAXED);}
+  inline void set_next_event(uint64_t e){__atomic_store_n(&this->next_event, e, __ATOMIC_RELAXED);}
+  void schedule_next_event();
+  void restore_snapshot();
+  void take_snapshot();
+  void write_profile();
+  void receive_input();
+  //value of csr n as csrrd sees it
+  inline uint32_t read_csr(uint32_t n) const {
+    if(n < CpuContext::STORED_CSRS) return this->context.status_registers[n];
+    //one instruction is one cycle of the virtual clock
+    switch(n){
+      case CpuContext::CSR_INSTRET: case CpuContext::CSR_CYCLE: return static_cast<uint32_t>(this->instructions_retired);
+      case CpuContext::CSR_INSTRETH: case CpuContext::CSR_CYCLEH: return static_cast<uint32_t>(this->instructions_retired >> 32);
+    }
+    if(n < CpuContext::CSR_COUNT) return static_cast<uint32_t>(this->context.events[n - CpuContext::CSR_BRANCHES]);
+    return 0;
+  }
+  inline void count(CpuContext::Event event){++this->context.events[event];}
+  void step_instruction();
+  void interrupt(uint32_t cause);
 
-  void print_segments();
   void print_register_status();
+  void print_registers();
   void print_register_temp();
 
-  Segment* get_segment_by_address(ulong a);
-
   void push_pc();
   void push_pc_special();
   void push_status();
 
 public:
-  Emulator(ifstream* i);
+  //false for encodings that have no handler, they throw when executed
+  static bool is_implemented(uint8_t opcode, uint8_t mode);
+
+  //loads the image, or the snapshot with o.restore, and resets
+  Emulator(const string& filename, EmulatorOptions o = EmulatorOptions());
+  //nothing is loaded, images are added with the load functions
+  Emulator(EmulatorOptions o);
   ~Emulator();
+
+  Emulator(const Emulator&) = delete;
+  Emulator& operator=(const Emulator&) = delete;
+
+  //runs from reset to the halt as the emulator program does, repeat times, and prints the state unless detached
+  void run();
+  //throws unless something was loaded at the entry point, run checks it first, run_for and step leave it to the caller
+  void check_entry() const;
+
+  //EMBEDDING
+  //hart 0 is driven by the caller, an emulator with more harts can only run()
+
+  //hex or -bin image, a -bin image also sets the entry point, images loaded later overwrite earlier ones
+  void load_file(const string& filename);
+  //hex text as the linker writes it
+  void load_hex(const string& text);
+  inline void load_bytes(uint32_t a, const uint8_t* bytes, size_t size){this->memory->write_bytes(a, bytes, size);}
+  //the pc after the next reset
+  inline void set_entry(uint32_t a){this->starting_address = a;}
+  //registers and csrs to their reset values, memory is kept
+  void reset();
+
+  //returns the number of instructions run, less than n once the guest halted or exited
+  uint64_t run_for(uint64_t n);
+  //one instruction, false if the guest already halted or exited
+  bool step();
+  inline bool is_finished() const {return this->halted || this->semihost->has_exited();}
+
+  inline uint32_t get_register(uint32_t n) const {return this->context.registers[n & 0xF];}
+  inline void set_register(uint32_t n, uint32_t v){this->context.registers[n & 0xF] = v;}
+  inline uint32_t get_csr(uint32_t n) const {return this->read_csr(n);}
+  inline uint32_t read_word(uint32_t a) const {return this->memory->read_word(a);}
+  inline void write_word(uint32_t a, uint32_t v){this->memory->write_word(a, v);}
+  inline void read_bytes(uint32_t a, uint8_t* bytes, size_t size) const {this->memory->read_bytes(a, bytes, size);}
+  inline void write_bytes(uint32_t a, const uint8_t* bytes, size_t size){this->memory->write_bytes(a, bytes, size);}
+
+  //registers at base to base + size, must not overlap the built-in devices, written is called on every guest store into them
+  //devices are added before the emulator runs, harts look at the device list without a lock
+  void add_device(uint32_t base, uint32_t size, CallbackDevice::Callback written);
+  //for added devices, the interrupt is taken once the guest does not mask it
+  void raise_interrupt(uint32_t cause);
+
+  //terminal input of a detached emulator, delivered a character per terminal interrupt
+  inline void send_input(const string& text){this->terminal->send(text);}
+  //input sent but not yet read by the guest
+  inline bool has_input_waiting() const {
+    return this->terminal->has_input() || this->interrupts->is_pending(CpuContext::CAUSE_TERMINAL);
+  }
+  inline bool can_take_interrupt(uint32_t cause) const {
+    return !InterruptController::is_masked(this->context.status_registers[0], cause);
+  }
+  //steps at most max_steps instructions looking for a loop that only an interrupt can leave, then puts the hart back
+  bool is_waiting(uint32_t max_steps);
+
+  //state after the run, hart 0
+  inline const CpuContext& get_context() const {return this->context;}
+  inline uint64_t get_instructions_retired() const {return this->instructions_retired;}
+  inline const string& get_terminal_output() const {return this->terminal->get_captured();}
+  //the run ended with a semihosting exit rather than halt
+  inline bool has_exited() const {return this->semihost->has_exited();}
+  inline uint32_t get_exit_code() const {return this->semihost->get_exit_code();}
 };
 
 #endif
\ No newline at end of file
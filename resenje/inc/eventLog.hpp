@@ -0,0 +1,74 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+//log of the input the emulator got from the host, the only thing that makes two runs of an image differ
+//the timer is not in it, its interrupts already follow the retired instruction count
+//header: magic "EMUEVLOG", u32 version
+//record: varint instructions retired since the previous record, u8 device, varint value
+//varints are little endian base 128, 7 bits per byte and the top bit set on every byte but the last
+struct EventLogFormat{
+  static constexpr const char* MAGIC = "EMUEVLOG";
+  static const uint32_t MAGIC_SIZE = 8;
+  static const uint32_t VERSION = 1;
+
+  //devices
+  static const uint8_t TERMINAL = 1;    //value is the character moved into term_in
+};
+
+struct InputEvent{
+  uint64_t instruction;     //instructions retired when the event was delivered
+  uint8_t device;
+  uint32_t value;
+};
+
+//appends every delivered event, events are rare so the file is written through stdio buffering
+class EventRecorder{
+private:
+  FILE* file;
+  uint64_t last_instruction;
+
+  void put_varint(uint64_t v);
+
+public:
+  EventRecorder(const string& filename);
+  ~EventRecorder();
+
+  EventRecorder(const EventRecorder&) = delete;
+  EventRecorder& operator=(const EventRecorder&) = delete;
+
+  void record(uint64_t instruction, uint8_t device, uint32_t value);
+};
+
+//whole log read up front, events are handed out in order once their instruction count is reached
+class EventReplayer{
+private:
+  vector<InputEvent> events;
+  size_t next;
+  uint64_t late;            //events delivered past their instruction count, the run diverged from the recorded one
+
+public:
+  static const uint64_t NO_EVENT = UINT64_MAX;
+
+  EventReplayer(const string& filename);
+
+  //instruction count of the next event, NO_EVENT once all were delivered
+  inline uint64_t get_next_instruction() const {
+    return this->next < this->events.size() ? this->events[this->next].instruction : NO_EVENT;
+  }
+  inline bool is_due(uint64_t instruction, uint8_t device) const {
+    return this->next < this->events.size() && this->events[this->next].instruction <= instruction && this->events[this->next].device == device;
+  }
+  inline size_t get_remaining() const {return this->events.size() - this->next;}
+  inline uint64_t get_late() const {return this->late;}
+
+  //the next event, which must be due
+  uint32_t take(uint64_t instruction);
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef HEXLOADER_H
+#define HEXLOADER_H
+
+#include <string>
+#include <vector>
+#include "memory.hpp"
+using namespace std;
+
+//loads the linker's hex output, lines of "0xADDR\tBB\tBB..." with up to 8 bytes each
+//the file is mmap'd and scanned in place, large images are split at line boundaries and scanned by several threads
+class HexLoader{
+public:
+  static const size_t PARALLEL_THRESHOLD = 4 << 20;   //smaller files are scanned by the calling thread
+  static const size_t MIN_CHUNK_SIZE = 1 << 20;
+  static const int BYTES_PER_LINE = 8;
+
+private:
+  //consecutive lines are merged into runs, only runs are copied into guest memory
+  struct Run{
+    uint32_t address;
+    size_t offset;      //into Chunk::bytes
+    size_t size;
+  };
+
+  struct Chunk{
+    const char* begin;
+    const char* end;
+    vector<Run> runs;
+    vector<uint8_t> bytes;
+    string error;
+  };
+
+  static void scan(Chunk* c);
+
+public:
+  static void load(const string& filename, Memory* m);
+  //same for hex text that is already in host memory
+  static void load_text(const char* text, size_t size, Memory* m);
+};
+
+#endif
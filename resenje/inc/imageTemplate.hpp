@@ -0,0 +1,30 @@
+#ifndef IMAGETEMPLATE_H
+#define IMAGETEMPLATE_H
+
+#include <string>
+#include <cstdio>
+#include "memory.hpp"
+using namespace std;
+
+//an image loaded once and kept as a -bin image in an unlinked temporary file
+//every batch instance maps it privately, so pages the guest only reads (code, constants) stay shared
+//between all instances and a page the guest writes is copied by the host for that instance only
+class ImageTemplate{
+private:
+  string filename;
+  FILE* file;
+  uint32_t entry;
+
+public:
+  ImageTemplate(const string& image);
+  ~ImageTemplate();
+
+  ImageTemplate(const ImageTemplate&) = delete;
+  ImageTemplate& operator=(const ImageTemplate&) = delete;
+
+  inline const string& get_filename() const {return this->filename;}
+  inline int get_descriptor() const {return fileno(this->file);}
+  inline uint32_t get_entry() const {return this->entry;}
+};
+
+#endif
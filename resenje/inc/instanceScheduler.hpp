@@ -0,0 +1,63 @@
+#ifndef INSTANCESCHEDULER_H
+#define INSTANCESCHEDULER_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "emulator.hpp"
+using namespace std;
+
+//runs many single-hart emulators, each for a quantum of instructions in turn,
+//on the calling thread or on a work-stealing pool where a thread out of instances takes a runnable one from another
+//an instance is resumed with run_for, so all of its state stays in its Emulator and nothing is saved between slices
+//an instance found waiting for terminal input is parked until input is sent to it, instead of spinning every round:
+//after a slice without stores or interrupts the guest is stepped a little to see whether it is in a loop
+//that only an interrupt can leave, and it is parked if the timer can not end the wait and no input is waiting
+class InstanceScheduler{
+public:
+  enum State: uint8_t {RUNNABLE, PARKED, FINISHED, FAILED};
+
+  static const uint32_t PROBE_STEPS = 64;      //longest wait loop that is recognized
+
+private:
+  struct Instance{
+    Emulator* emulator;
+    State state;
+    bool queued;              //in the runnable queue
+    uint64_t host_ns;         //host time spent in its slices
+    uint64_t slices;
+    string failure;
+  };
+
+  uint64_t quantum;
+  vector<Instance> instances;
+  deque<uint32_t> runnable;
+
+  void enqueue(uint32_t id);
+  void run_slice(uint32_t id);
+
+public:
+  InstanceScheduler(uint64_t quantum);
+
+  InstanceScheduler(const InstanceScheduler&) = delete;
+  InstanceScheduler& operator=(const InstanceScheduler&) = delete;
+
+  //the emulator stays the caller's and must be detached, it is run from where it is now, returns its id
+  uint32_t add(Emulator* e);
+  //wakes the instance if it is parked
+  void send_input(uint32_t id, const string& text);
+
+  //slices until no instance is runnable, the rest are finished, failed or parked
+  //with more than one thread an instance is only ever sliced by one thread at a time, but may move between them,
+  //send_input and add must not be called until it returns
+  void run(uint threads = 1);
+
+  inline State get_state(uint32_t id) const {return this->instances[id].state;}
+  inline const string& get_failure(uint32_t id) const {return this->instances[id].failure;}
+  inline double get_seconds(uint32_t id) const {return this->instances[id].host_ns / 1e9;}
+  inline uint64_t get_slices(uint32_t id) const {return this->instances[id].slices;}
+  inline size_t get_count() const {return this->instances.size();}
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef INTERRUPTCONTROLLER_H
+#define INTERRUPTCONTROLLER_H
+
+#include <cstdint>
+#include <vector>
+#include "cpuContext.hpp"
+#include "memory.hpp"
+
+//pending external interrupts of one hart as a bitmask indexed by cause
+//the cores never test it directly, raising an interrupt or changing the mask in status
+//pulls the hart's next_event to 0, so it is looked at before the next block
+//other harts' threads may raise into it, pending is only changed atomically
+class InterruptController{
+private:
+  uint32_t pending;
+  uint64_t* next_event;
+
+  //a concurrent reschedule by the owning hart may overwrite this,
+  //the interrupt stays pending and is then taken at the next scheduled event
+  inline void request_check(){
+    __atomic_store_n(this->next_event, 0, __ATOMIC_RELAXED);
+  }
+
+  //causes that status does not let through
+  static inline uint32_t masked(uint32_t status){
+    uint32_t m = 0;
+    if(status & CpuContext::STATUS_INTERRUPTS) m |= (1u << CpuContext::CAUSE_TIMER) | (1u << CpuContext::CAUSE_TERMINAL);
+    if(status & CpuContext::STATUS_TIMER) m |= 1u << CpuContext::CAUSE_TIMER;
+    if(status & CpuContext::STATUS_TERMINAL) m |= 1u << CpuContext::CAUSE_TERMINAL;
+    return m;
+  }
+
+public:
+  InterruptController(uint64_t* next_event){
+    this->pending = 0;
+    this->next_event = next_event;
+  }
+
+  static inline bool is_masked(uint32_t status, uint32_t cause){return masked(status) & (1u << cause);}
+
+  inline void reset(){__atomic_store_n(&this->pending, 0, __ATOMIC_RELAXED);}
+  inline uint32_t get_pending() const {return __atomic_load_n(&this->pending, __ATOMIC_RELAXED);}
+  inline void set_pending(uint32_t p){
+    __atomic_store_n(&this->pending, p, __ATOMIC_RELAXED);
+    this->request_check();
+  }
+  inline bool is_pending(uint32_t cause) const {return this->get_pending() & (1u << cause);}
+
+  inline void raise(uint32_t cause){
+    __atomic_fetch_or(&this->pending, 1u << cause, __ATOMIC_RELAXED);
+    this->request_check();
+  }
+
+  //status was written, a pending interrupt may have been unmasked
+  inline void mask_changed(){
+    if(this->get_pending()) this->request_check();
+  }
+
+  //removes and returns the deliverable cause with the lowest number, 0 if status masks all of them
+  inline uint32_t take(uint32_t status){
+    uint32_t deliverable = this->get_pending() & ~masked(status);
+    if(deliverable == 0) return 0;
+    uint32_t cause = __builtin_ctz(deliverable);
+    __atomic_fetch_and(&this->pending, ~(1u << cause), __ATOMIC_RELAXED);
+    return cause;
+  }
+};
+
+//routes device interrupts to the harts
+//int_route holds the target hart of every cause in the nibble at bits 4*cause+3..4*cause, 0 after reset
+//a cause routed past the last hart goes to hart 0, software interrupts always stay on the hart that executed int
+class InterruptRouter: public MmioDevice{
+public:
+  static const uint32_t INT_ROUTE = 0xFFFFFF20;
+  static const uint32_t REGISTERS_SIZE = 4;
+  static const uint32_t MAX_HARTS = 16;
+
+private:
+  Memory* memory;
+  std::vector<InterruptController*> harts;
+  uint32_t routes;
+
+public:
+  InterruptRouter(Memory* m){
+    this->memory = m;
+    this->routes = 0;
+    this->memory->map_device(INT_ROUTE, REGISTERS_SIZE, this);
+  }
+
+  InterruptRouter(const InterruptRouter&) = delete;
+  InterruptRouter& operator=(const InterruptRouter&) = delete;
+
+  inline void add_hart(InterruptController* c){this->harts.push_back(c);}
+
+  inline void reset(){this->memory->write_word(INT_ROUTE, 0);}
+
+  inline InterruptController* target(uint32_t cause) const {
+    uint32_t hart = (this->routes >> (4 * cause)) & 0xF;
+    return hart < this->harts.size() ? this->harts[hart] : this->harts[0];
+  }
+
+  inline void raise(uint32_t cause){this->target(cause)->raise(cause);}
+  inline bool is_pending(uint32_t cause) const {return this->target(cause)->is_pending(cause);}
+
+  void mmio_written(uint32_t address, uint32_t size) override {
+    this->routes = this->memory->read_word(INT_ROUTE);
+  }
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <vector>
+#include <exception>
+#include "blockCache.hpp"
+#include "cpuContext.hpp"
+using namespace std;
+
+//compiles hot translated blocks into native x86-64 code placed in mmap'd executable pages
+//register arithmetic, literal loads and plain memory accesses are emitted inline,
+//CSR accesses, int, calls, jumps and anything touching flagged pages (code, device registers) go back to the interpreter handlers
+//exceptions can not unwind through native frames, the helpers catch them and report a failure native code tests,
+//it then leaves the block and the core rethrows the exception once it is back, see take_failure
+class JitCompiler{
+public:
+  static const uint32_t HOT_THRESHOLD = 16;       //block executions before it is compiled
+  static const size_t ARENA_SIZE = 16 << 20;
+
+private:
+  uint8_t* arena;
+  size_t arena_used;
+  bool available;
+  size_t compiled_blocks;
+  vector<uint8_t> code;     //native code of the block being compiled
+  bool failed;              //a helper caught an exception, the core rethrows it after the native block
+  std::exception_ptr failure;
+
+  //guest memory access and interpreter entry points called from native code
+  //the load returns the word in the low half and a failure in the high half, the others return true on a failure
+  static uint64_t load_helper(Emulator* e, uint32_t a);
+  static bool store_helper(Emulator* e, uint32_t a, uint32_t v);
+  static bool interpret_helper(Emulator* e, const MicroOp* op);
+  void fail(std::exception_ptr f);
+
+  bool is_native(const TranslatedBlock* b, size_t i) const;
+
+  //emitting
+  void emit(std::initializer_list<uint8_t> bytes);
+  void emit32(uint32_t v);
+  void emit64(uint64_t v);
+  size_t emit_jump(std::initializer_list<uint8_t> opcode);
+  void patch_jump(size_t position);
+
+  void emit_prologue();
+  void emit_exit(uint32_t executed);
+  void emit_load_register(uint8_t host, uint8_t guest);
+  void emit_store_register(uint8_t guest, uint8_t host);
+  void emit_register_operation(uint8_t opcode, uint8_t a, uint8_t b, uint8_t c);
+  void emit_effective_address(uint8_t a, uint8_t b, int32_t d);
+  void emit_exit_if_failed(uint32_t executed);
+  void emit_memory_load(uint32_t executed);
+  void emit_memory_store(const TranslatedBlock* b, uint32_t executed);
+  void emit_count(CpuContext::Event event);
+  void emit_interpreter_call(const TranslatedBlock* b, const MicroOp* op, uint32_t executed);
+  void emit_micro_op(const TranslatedBlock* b, size_t i);
+
+public:
+  JitCompiler();
+  ~JitCompiler();
+
+  JitCompiler(const JitCompiler&) = delete;
+  JitCompiler& operator=(const JitCompiler&) = delete;
+
+  inline bool is_available() const {return this->available;}
+  inline size_t get_compiled_count() const {return this->compiled_blocks;}
+  inline bool has_failed() const {return this->failed;}
+  //rethrows the exception a helper caught while the native block ran
+  void take_failure();
+
+  //returns nullptr if the host is not x86-64 or the arena is full, the block then stays interpreted
+  NativeBlock compile(TranslatedBlock* b);
+};
+
+#endif
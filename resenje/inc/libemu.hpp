@@ -0,0 +1,21 @@
+#ifndef LIBEMU_H
+#define LIBEMU_H
+
+//interface of libemu, the emulator as a library for test harnesses and other programs that run guests in-process
+//build: g++ -O2 -pthread -c ../src/libemu.cpp && ar rcs libemu.a libemu.o, then link the program with libemu.a -pthread
+//
+//  EmulatorOptions o;
+//  o.detached = true;                  //no host terminal or files, guest output is kept for get_terminal_output
+//  Emulator e(o);
+//  e.load_file("program.hex");         //or load_hex, load_bytes and set_entry
+//  e.reset();
+//  while(!e.is_finished() && e.run_for(100000) > 0){ ... }
+//  uint32_t r1 = e.get_register(1);
+//
+//errors are thrown as ExceptionAlert, an emulator stays usable after reset()
+//InstanceScheduler time-slices many such emulators on the calling thread or a thread pool, BatchRunner runs a jobs file
+#include "emulator.hpp"
+#include "instanceScheduler.hpp"
+#include "batch.hpp"
+
+#endif
@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include <fstream>
 #include "assembler.hpp"
+#include "binaryImage.hpp"
 using namespace std;
 
 class Linker{
@@ -72,6 +73,8 @@ public:
   void print_relocation_table();
   void print_segment_table();
   void print_hex();
+  void print_bin(uint32_t entry);
+  void print_symbol_map(ofstream* f);
   
   void change_section_id_unique();
   void change_symbol_id_unique();
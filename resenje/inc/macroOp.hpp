@@ -0,0 +1,77 @@
+#ifndef MACROOP_H
+#define MACROOP_H
+
+#include <cstdint>
+
+//instruction sequences the assembler emits for a single source instruction
+//a sequence is recognized once, when its first word is decoded, and the decoded entry then stands for all of it:
+//a handler of its own runs the whole sequence as one step and a literal it carries is read at decode time
+//words are as read from memory, byte I of the instruction is the low byte
+struct MacroOp{
+  enum Kind: uint8_t{
+    NONE,
+    IRET,             //pop pc; pop status, no interrupt may come in between
+    LOAD_LITERAL,     //pop gpr[A] from pc; literal, the ld $literal form
+    BRANCH_LITERAL,   //jmp, beq, bne or bgt to mem[pc + 4]; pc += 4; literal
+    CALL_LITERAL,     //call mem[pc]; literal
+    COUNT
+  };
+
+  static const uint32_t MAX_WORDS = 3;
+  //macro-op handlers follow the 256 handlers selected by byte I
+  static const uint16_t HANDLER_BASE = 256;
+
+  //fixed words of the sequences
+  static const uint32_t POP_PC = 0x0400FE93;        //pop pc, all of ret
+  static const uint32_t POP_STATUS = 0x04000E97;    //second word of iret
+  static const uint32_t SKIP_LITERAL = 0x0400FF91;  //pc += 4, a branch not taken jumps over its literal
+};
+
+//one recognizable sequence, the table below is tried in order
+struct MacroOpPattern{
+  MacroOp::Kind kind;
+  uint8_t words;
+  uint8_t literal_word;     //index of the literal among the words, 0 when the sequence carries none
+  bool (*match)(const uint32_t* words);
+};
+
+class MacroOps{
+private:
+  //fields of a raw word, same split as DecodedInstruction::decode
+  static constexpr uint32_t opcode(uint32_t w){return (w >> 4) & 0xF;}
+  static constexpr uint32_t mode(uint32_t w){return w & 0xF;}
+  static constexpr uint32_t a(uint32_t w){return (w >> 12) & 0xF;}
+  static constexpr uint32_t b(uint32_t w){return (w >> 8) & 0xF;}
+  static constexpr uint32_t d(uint32_t w){return ((w >> 8) & 0xF00) | ((w >> 24) & 0xFF);}
+
+  static bool is_iret(const uint32_t* w){
+    return w[0] == MacroOp::POP_PC && w[1] == MacroOp::POP_STATUS;
+  }
+  static bool is_load_literal(const uint32_t* w){
+    return opcode(w[0]) == 0x9 && mode(w[0]) == 0x3 && b(w[0]) == 0xF && a(w[0]) != 0xF && d(w[0]) == 4;
+  }
+  static bool is_branch_literal(const uint32_t* w){
+    return opcode(w[0]) == 0x3 && (mode(w[0]) & 0xC) == 0x8 && a(w[0]) == 0xF && d(w[0]) == 4 && w[1] == MacroOp::SKIP_LITERAL;
+  }
+  static bool is_call_literal(const uint32_t* w){
+    return opcode(w[0]) == 0x2 && mode(w[0]) == 0x1 && a(w[0]) == 0xF && b(w[0]) == 0 && d(w[0]) == 0;
+  }
+
+  static constexpr MacroOpPattern PATTERNS[] = {
+    {MacroOp::IRET, 2, 0, &MacroOps::is_iret},
+    {MacroOp::LOAD_LITERAL, 2, 1, &MacroOps::is_load_literal},
+    {MacroOp::BRANCH_LITERAL, 3, 2, &MacroOps::is_branch_literal},
+    {MacroOp::CALL_LITERAL, 2, 1, &MacroOps::is_call_literal},
+  };
+
+public:
+  //sequence starting with words[0], nullptr if there is none, MAX_WORDS words are always given
+  static const MacroOpPattern* recognize(const uint32_t* words){
+    for(const MacroOpPattern& p : PATTERNS){
+      if(p.match(words)) return &p;
+    }
+    return nullptr;
+  }
+};
+
+#endif
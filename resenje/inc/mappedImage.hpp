@@ -0,0 +1,35 @@
+#ifndef MAPPEDIMAGE_H
+#define MAPPEDIMAGE_H
+
+#include <string>
+#include "binaryImage.hpp"
+#include "memory.hpp"
+using namespace std;
+
+//a -bin image mmap'd privately, whole guest pages point straight into the mapping
+//guest writes are copied by the host on first write and never reach the file
+class MappedImage{
+private:
+  uint8_t* mapping;
+  size_t mapping_size;
+  const BinaryImageHeader* header;
+  const BinaryImageSegment* segments;
+
+  void map(int fd, const string& filename);
+
+public:
+  MappedImage(const string& filename);
+  //maps an image that is already open, e.g. a batch template, the descriptor stays the caller's
+  MappedImage(int fd, const string& filename);
+  ~MappedImage();
+
+  MappedImage(const MappedImage&) = delete;
+  MappedImage& operator=(const MappedImage&) = delete;
+
+  inline uint32_t get_entry() const {return this->header->entry;}
+
+  //the image must outlive the memory, it owns the mapped pages
+  void map_into(Memory* m);
+};
+
+#endif
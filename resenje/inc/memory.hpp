@@ -0,0 +1,283 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include <mutex>
+#include "exceptionAlert.hpp"
+using namespace std;
+
+//notified when the guest writes into a page that was marked as holding code
+class CodeWriteListener{
+public:
+  virtual ~CodeWriteListener(){}
+  virtual void code_written(uint32_t address, uint32_t size) = 0;
+};
+
+//notified when the guest writes into a page that holds a watched address
+class WatchListener{
+public:
+  virtual ~WatchListener(){}
+  virtual void watched_write(uint32_t address, uint32_t size) = 0;
+};
+
+//memory mapped device, told about guest writes into its register window
+//the registers themselves live in guest memory, so reads need no hook and a device publishes values by writing them there
+class MmioDevice{
+public:
+  virtual ~MmioDevice(){}
+  virtual void mmio_written(uint32_t address, uint32_t size) = 0;
+};
+
+//guest memory, the whole 32-bit address space split into 4KB pages
+//page table is a flat array indexed by page number, so every access is O(1)
+//pages are allocated and zero filled the first time they are written, reads of untouched memory return 0
+//words are stored little endian, same as the linker places them in the hex file
+//several harts may share it, page allocation and device callbacks are serialized, plain accesses are not
+class Memory{
+public:
+  static const uint32_t PAGE_BITS = 12;
+  static const uint32_t PAGE_SIZE = 1u << PAGE_BITS;
+  static const uint32_t PAGE_MASK = PAGE_SIZE - 1;
+  static const uint32_t PAGE_COUNT = 1u << (32 - PAGE_BITS);
+
+  //page flags
+  static const uint8_t PAGE_CODE = 0x1;   //instructions from this page were decoded, writes must be reported
+  static const uint8_t PAGE_MMIO = 0x2;   //page holds device registers, writes into its device span must be reported
+  static const uint8_t PAGE_WATCH = 0x4;  //page holds a watchpoint, writes must be reported
+
+private:
+  uint8_t** pages;                  //PAGE_COUNT entries, nullptr until the page is touched
+  vector<uint32_t> mapped_pages;    //page numbers in order of allocation
+  vector<bool> owned_pages;         //false for pages mapped from host memory, parallel to mapped_pages
+  uint8_t* page_flags;              //PAGE_COUNT entries
+  uint32_t* device_spans;           //PAGE_COUNT entries, first byte of the devices in the page | bytes they cover << 16
+  vector<CodeWriteListener*> code_write_listeners;
+  WatchListener* watch_listener;    //the debugger, when there is one
+
+  struct DeviceWindow{
+    uint32_t base;
+    uint32_t size;
+    MmioDevice* device;
+  };
+  vector<DeviceWindow> devices;
+  std::mutex allocation_lock;
+  std::recursive_mutex device_lock;   //devices may write their own registers from a callback
+
+  //a page holding only device registers is reported only for writes into the bytes the devices cover,
+  //so a stack sharing the page with them stays on the fast path
+  inline bool must_report(uint32_t a, uint32_t size) const {
+    uint8_t flags = this->get_page_flags(a);
+    if(flags != PAGE_MMIO) return flags != 0;
+    uint32_t span = this->device_spans[a >> PAGE_BITS];
+    uint32_t offset = a & PAGE_MASK;
+    return offset < (span & 0xFFFF) + (span >> 16) && offset + size > (span & 0xFFFF);
+  }
+
+  //slow path of every write into a page with flags
+  void report_write(uint32_t a, uint32_t size){
+    uint8_t flags = this->get_page_flags(a);
+    if(flags & PAGE_CODE){
+      for(size_t i = 0 ; i < this->code_write_listeners.size() ; ++i){
+        this->code_write_listeners[i]->code_written(a, size);
+      }
+    }
+    if(flags & PAGE_MMIO){
+      //windows are only added before the harts start, so they are looked at without the lock
+      for(size_t i = 0 ; i < this->devices.size() ; ++i){
+        const DeviceWindow& w = this->devices[i];
+        if(a < w.base + w.size && a + size > w.base){
+          std::lock_guard<std::recursive_mutex> guard(this->device_lock);
+          w.device->mmio_written(a, size);
+        }
+      }
+    }
+    if((flags & PAGE_WATCH) && this->watch_listener != nullptr) this->watch_listener->watched_write(a, size);
+  }
+
+  //entry n of the table, other harts may be publishing pages into it, see allocate_page
+  inline uint8_t* page_at(uint32_t n) const {return __atomic_load_n(&this->pages[n], __ATOMIC_ACQUIRE);}
+
+  //another hart may have allocated the page since the caller looked, the table entry is published last
+  uint8_t* allocate_page(uint32_t n){
+    std::lock_guard<std::mutex> guard(this->allocation_lock);
+    uint8_t* allocated = this->page_at(n);
+    if(allocated != nullptr) return allocated;
+    uint8_t* page = static_cast<uint8_t*>(calloc(PAGE_SIZE, 1));
+    if(page == nullptr) throw ExceptionAlert("Out of host memory while allocating a guest page.");
+    __atomic_store_n(&this->pages[n], page, __ATOMIC_RELEASE);
+    this->mapped_pages.push_back(n);
+    this->owned_pages.push_back(true);
+    return page;
+  }
+
+  static inline uint32_t load32(const uint8_t* p){
+    uint32_t v;
+    memcpy(&v, p, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+  }
+
+  static inline void store32(uint8_t* p, uint32_t v){
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    memcpy(p, &v, 4);
+  }
+
+public:
+  Memory(){
+    //calloc of a large block is backed by lazily zeroed host pages, only touched parts of the table cost memory
+    this->pages = static_cast<uint8_t**>(calloc(PAGE_COUNT, sizeof(uint8_t*)));
+    this->page_flags = static_cast<uint8_t*>(calloc(PAGE_COUNT, 1));
+    this->device_spans = static_cast<uint32_t*>(calloc(PAGE_COUNT, sizeof(uint32_t)));
+    this->watch_listener = nullptr;
+    if(this->pages == nullptr || this->page_flags == nullptr || this->device_spans == nullptr) throw ExceptionAlert("Out of host memory while allocating the page table.");
+  }
+
+  ~Memory(){
+    for(size_t i = 0 ; i < this->mapped_pages.size() ; ++i){
+      if(this->owned_pages[i]) free(this->pages[this->mapped_pages[i]]);
+    }
+    free(this->pages);
+    free(this->page_flags);
+    free(this->device_spans);
+  }
+
+  Memory(const Memory&) = delete;
+  Memory& operator=(const Memory&) = delete;
+
+  //GETTERS
+  inline bool is_mapped(uint32_t a) const {return this->page_at(a >> PAGE_BITS) != nullptr;}
+  inline size_t get_page_count() const {return this->mapped_pages.size();}
+  inline const vector<uint32_t>& get_mapped_pages() const {return this->mapped_pages;}
+  inline uint8_t get_page_flags(uint32_t a) const {return __atomic_load_n(&this->page_flags[a >> PAGE_BITS], __ATOMIC_RELAXED);}
+  //raw tables for native code, indexed by page number
+  inline uint8_t** get_page_table() const {return this->pages;}
+  inline uint8_t* get_page_flag_table() const {return this->page_flags;}
+  inline uint32_t* get_device_span_table() const {return this->device_spans;}
+
+  //SETTERS
+  inline void set_page_flags(uint32_t a, uint8_t f){__atomic_fetch_or(&this->page_flags[a >> PAGE_BITS], f, __ATOMIC_RELAXED);}
+  inline void clear_page_flags(uint32_t a, uint8_t f){__atomic_fetch_and(&this->page_flags[a >> PAGE_BITS], static_cast<uint8_t>(~f), __ATOMIC_RELAXED);}
+  inline void add_code_write_listener(CodeWriteListener* l){this->code_write_listeners.push_back(l);}
+  inline void set_watch_listener(WatchListener* l){this->watch_listener = l;}
+
+  //page n is backed by host memory owned by the caller, e.g. a mapped file, it is never freed here
+  void map_host_page(uint32_t n, uint8_t* page){
+    std::lock_guard<std::mutex> guard(this->allocation_lock);
+    if(n >= PAGE_COUNT || this->page_at(n) != nullptr) throw ExceptionAlert("Guest page is already mapped.");
+    __atomic_store_n(&this->pages[n], page, __ATOMIC_RELEASE);
+    this->mapped_pages.push_back(n);
+    this->owned_pages.push_back(false);
+  }
+
+  //device registers must not cross a page, the page is allocated so the registers can be read right away
+  //devices are mapped before any hart runs, see report_write
+  void map_device(uint32_t base, uint32_t size, MmioDevice* d){
+    if((base >> PAGE_BITS) != ((base + size - 1) >> PAGE_BITS)) throw ExceptionAlert("Device registers can not cross a page boundary.");
+    this->get_page(base);
+    uint32_t& span = this->device_spans[base >> PAGE_BITS];
+    uint32_t first = base & PAGE_MASK;
+    uint32_t end = first + size;
+    if(this->get_page_flags(base) & PAGE_MMIO){
+      end = std::max(end, (span & 0xFFFF) + (span >> 16));
+      first = std::min(first, span & 0xFFFF);
+    }
+    span = first | ((end - first) << 16);
+    this->set_page_flags(base, PAGE_MMIO);
+    this->devices.push_back({base, size, d});
+  }
+
+  //held by the hart that services devices while it looks at their state
+  inline std::recursive_mutex& get_device_lock(){return this->device_lock;}
+
+  //returns the page holding address a, allocating it if needed
+  inline uint8_t* get_page(uint32_t a){
+    uint8_t* page = this->page_at(a >> PAGE_BITS);
+    if(page == nullptr) page = this->allocate_page(a >> PAGE_BITS);
+    return page;
+  }
+
+  inline uint8_t read_byte(uint32_t a) const {
+    const uint8_t* page = this->page_at(a >> PAGE_BITS);
+    return page == nullptr ? 0 : page[a & PAGE_MASK];
+  }
+
+  inline void write_byte(uint32_t a, uint8_t v){
+    this->get_page(a)[a & PAGE_MASK] = v;
+    if(this->must_report(a, 1)) this->report_write(a, 1);
+  }
+
+  //copies a block of bytes page by page, flagged pages are reported once per page
+  void write_bytes(uint32_t a, const uint8_t* bytes, size_t size){
+    while(size > 0){
+      uint32_t offset = a & PAGE_MASK;
+      uint32_t n = std::min<size_t>(size, PAGE_SIZE - offset);
+      memcpy(this->get_page(a) + offset, bytes, n);
+      if(this->must_report(a, n)) this->report_write(a, n);
+      a += n;
+      bytes += n;
+      size -= n;
+    }
+  }
+
+  //copies a block of bytes out page by page, unmapped pages read as 0
+  void read_bytes(uint32_t a, uint8_t* bytes, size_t size) const {
+    while(size > 0){
+      uint32_t offset = a & PAGE_MASK;
+      uint32_t n = std::min<size_t>(size, PAGE_SIZE - offset);
+      const uint8_t* page = this->page_at(a >> PAGE_BITS);
+      if(page == nullptr) memset(bytes, 0, n);
+      else memcpy(bytes, page + offset, n);
+      a += n;
+      bytes += n;
+      size -= n;
+    }
+  }
+
+  inline uint32_t read_word(uint32_t a) const {
+    uint32_t offset = a & PAGE_MASK;
+    if(offset <= PAGE_SIZE - 4){
+      const uint8_t* page = this->page_at(a >> PAGE_BITS);
+      return page == nullptr ? 0 : load32(page + offset);
+    }
+    //word crosses a page boundary
+    return  (uint32_t)this->read_byte(a) | ((uint32_t)this->read_byte(a + 1) << 8) |
+            ((uint32_t)this->read_byte(a + 2) << 16) | ((uint32_t)this->read_byte(a + 3) << 24);
+  }
+
+  inline void write_word(uint32_t a, uint32_t v){
+    uint32_t offset = a & PAGE_MASK;
+    if(offset <= PAGE_SIZE - 4){
+      store32(this->get_page(a) + offset, v);
+      if(this->must_report(a, 4)) this->report_write(a, 4);
+      return;
+    }
+    //word crosses a page boundary
+    for(int i = 0 ; i < 4 ; ++i){
+      this->write_byte(a + i, static_cast<uint8_t>(v >> (8 * i)));
+    }
+  }
+
+  //stores v and returns the old word as one atomic host operation, so harts can use it as a lock
+  inline uint32_t exchange_word(uint32_t a, uint32_t v){
+    if(a & 0x3) throw ExceptionAlert("Atomic exchange needs a word aligned address.");
+    uint32_t* word = reinterpret_cast<uint32_t*>(this->get_page(a) + (a & PAGE_MASK));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint32_t old = __builtin_bswap32(__atomic_exchange_n(word, __builtin_bswap32(v), __ATOMIC_SEQ_CST));
+#else
+    uint32_t old = __atomic_exchange_n(word, v, __ATOMIC_SEQ_CST);
+#endif
+    if(this->must_report(a, 4)) this->report_write(a, 4);
+    return old;
+  }
+
+};
+
+#endif
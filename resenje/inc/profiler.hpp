@@ -0,0 +1,41 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <vector>
+#include <ostream>
+#include "memory.hpp"
+#include "symbolMap.hpp"
+using namespace std;
+
+//retired instruction count per PC
+//one lazily allocated flat counter array per executed code page, indexed by the word offset into the page
+class Profiler{
+public:
+  static const size_t REPORT_ROWS = 20;
+
+private:
+  static const uint32_t COUNTERS_PER_PAGE = Memory::PAGE_SIZE / 4;
+
+  uint64_t** counter_pages;   //Memory::PAGE_COUNT entries, nullptr until an instruction from the page retires
+  vector<uint32_t> counted_page_numbers;
+
+  uint64_t* allocate_page(uint32_t a);
+
+public:
+  Profiler();
+  ~Profiler();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  inline void count(uint32_t a){
+    uint64_t* page = this->counter_pages[a >> Memory::PAGE_BITS];
+    if(page == nullptr) page = this->allocate_page(a);
+    ++page[(a & Memory::PAGE_MASK) >> 2];
+  }
+
+  //hottest routines and addresses, symbols may be nullptr when there is no map
+  void report(ostream& out, const SymbolMap* symbols, Memory* memory) const;
+};
+
+#endif
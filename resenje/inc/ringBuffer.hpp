@@ -0,0 +1,74 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include "exceptionAlert.hpp"
+
+//lock-free byte ring for exactly one producer and one consumer thread
+//head is only written by the producer and tail only by the consumer, both grow without bound and are masked on access
+class RingBuffer{
+private:
+  uint8_t* data;
+  size_t capacity;          //power of two
+  size_t mask;
+  alignas(64) std::atomic<size_t> head;
+  alignas(64) std::atomic<size_t> tail;
+
+public:
+  RingBuffer(size_t capacity_bits){
+    this->capacity = size_t(1) << capacity_bits;
+    this->mask = this->capacity - 1;
+    this->data = new uint8_t[this->capacity];
+    this->head.store(0, std::memory_order_relaxed);
+    this->tail.store(0, std::memory_order_relaxed);
+  }
+
+  ~RingBuffer(){
+    delete[] this->data;
+  }
+
+  RingBuffer(const RingBuffer&) = delete;
+  RingBuffer& operator=(const RingBuffer&) = delete;
+
+  inline bool empty() const {
+    return this->head.load(std::memory_order_acquire) == this->tail.load(std::memory_order_acquire);
+  }
+
+  //PRODUCER
+  //false if there is no room for all n bytes, nothing is written then
+  bool try_write(const uint8_t* bytes, size_t n){
+    size_t h = this->head.load(std::memory_order_relaxed);
+    if(h + n - this->tail.load(std::memory_order_acquire) > this->capacity) return false;
+    size_t position = h & this->mask;
+    size_t first = std::min(n, this->capacity - position);
+    memcpy(this->data + position, bytes, first);
+    memcpy(this->data, bytes + first, n - first);
+    this->head.store(h + n, std::memory_order_release);
+    return true;
+  }
+
+  //blocks while the consumer makes room, nothing is ever dropped
+  void write(const uint8_t* bytes, size_t n){
+    if(n > this->capacity) throw ExceptionAlert("Record is larger than the ring buffer.");
+    while(!this->try_write(bytes, n)) std::this_thread::yield();
+  }
+
+  //CONSUMER
+  //returns the number of bytes readable at *bytes without wrapping, 0 when empty
+  size_t peek(const uint8_t** bytes) const {
+    size_t t = this->tail.load(std::memory_order_relaxed);
+    size_t available = this->head.load(std::memory_order_acquire) - t;
+    size_t position = t & this->mask;
+    *bytes = this->data + position;
+    return std::min(available, this->capacity - position);
+  }
+
+  void consume(size_t n){
+    this->tail.store(this->tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+  }
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef SEMIHOST_H
+#define SEMIHOST_H
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include "memory.hpp"
+#include "terminal.hpp"
+using namespace std;
+
+//semihosting device, lets the guest hand whole buffers to the host instead of moving them a word at a time
+//the guest fills sh_addr, sh_len, sh_name and sh_arg, then writes a command into sh_cmd,
+//the host carries it out as one copy between guest memory and the host before the store retires,
+//sh_result gets the number of bytes moved or ERROR, and sh_cmd reads 0 again
+//sh_addr: guest buffer, sh_len: its size in bytes, sh_name: guest address of a file name ending with 0
+//sh_arg: file offset of READ_FILE, exit code of EXIT
+//a detached emulator has no host side, its file commands fail with ERROR so batch jobs can not write over each other
+class Semihost: public MmioDevice{
+public:
+  enum Command{
+    NONE,
+    WRITE,          //buffer to the host stdout, in order with the terminal output
+    WRITE_FILE,     //buffer to the named file, the first write of a run truncates it and later ones append
+    READ_FILE,      //at most sh_len bytes of the named file from offset sh_arg into the buffer
+    EXIT            //the run ends at the next service point with sh_arg as its exit code
+  };
+
+  static const uint32_t SH_CMD = 0xFFFFFF30;
+  static const uint32_t SH_ADDR = 0xFFFFFF34;
+  static const uint32_t SH_LEN = 0xFFFFFF38;
+  static const uint32_t SH_NAME = 0xFFFFFF3C;
+  static const uint32_t SH_ARG = 0xFFFFFF40;
+  static const uint32_t SH_RESULT = 0xFFFFFF44;
+  static const uint32_t REGISTERS_SIZE = 0x18;
+
+  static const uint32_t ERROR = 0xFFFFFFFF;
+
+private:
+  static const uint32_t MAX_NAME = 4096;
+  static const uint32_t CHUNK_SIZE = 1 << 16;   //host side copies go through a buffer of this size
+
+  Memory* memory;
+  Terminal* terminal;
+  uint64_t* next_event;     //pulled in so the exit is seen right away
+  bool host_files;          //false when detached, WRITE_FILE and READ_FILE then fail
+  unordered_map<string, FILE*> files;   //written files, open for the rest of the run
+  std::atomic<bool> exited;
+  uint32_t exit_code;
+
+  bool read_name(string& name);
+  uint32_t write(FILE* file);
+  uint32_t read_file(FILE* file, uint32_t offset);
+  uint32_t execute(uint32_t command);
+  void close_files();
+
+public:
+  Semihost(Memory* m, Terminal* t, uint64_t* next_event, bool host_files);
+  ~Semihost();
+
+  Semihost(const Semihost&) = delete;
+  Semihost& operator=(const Semihost&) = delete;
+
+  inline bool has_exited() const {return this->exited.load(std::memory_order_acquire);}
+  inline uint32_t get_exit_code() const {return this->exit_code;}
+
+  //registers are 0 after reset, files written by the previous run are closed
+  void reset();
+
+  void mmio_written(uint32_t address, uint32_t size) override;
+};
+
+#endif
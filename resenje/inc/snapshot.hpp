@@ -0,0 +1,49 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+#include "cpuContext.hpp"
+#include "memory.hpp"
+using namespace std;
+
+//emulator state stored in the first page of a snapshot file
+struct SnapshotHeader{
+  char magic[8];
+  uint32_t version;
+  uint32_t page_count;
+  uint64_t instructions_retired;
+  uint64_t timer_remaining;       //instructions until the next timer interrupt
+  uint32_t pending_interrupts;
+  CpuContext context;
+};
+
+//snapshot file: header, table of guest page numbers, then the pages themselves, every part page aligned
+//a restored snapshot is mmap'd privately, guest pages point straight into the mapping and are copied by the host on first write
+class Snapshot{
+public:
+  static constexpr const char* MAGIC = "EMUSNAP";
+  static const uint32_t VERSION = 3;
+
+private:
+  uint8_t* mapping;
+  size_t mapping_size;
+  const SnapshotHeader* header;
+
+  static size_t pages_offset(uint32_t page_count);
+
+public:
+  static void save(const string& filename, const SnapshotHeader& header, const Memory* m);
+
+  Snapshot(const string& filename);
+  ~Snapshot();
+
+  Snapshot(const Snapshot&) = delete;
+  Snapshot& operator=(const Snapshot&) = delete;
+
+  inline const SnapshotHeader& get_header() const {return *this->header;}
+
+  //the snapshot must outlive the memory, it owns the pages
+  void map_into(Memory* m);
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef SYMBOLMAP_H
+#define SYMBOLMAP_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+using namespace std;
+
+struct MappedSymbol{
+  enum Kind {SECTION, GLOBAL, LOCAL};
+
+  uint32_t address;
+  Kind kind;
+  string name;
+};
+
+//symbols of a linked program as written by the linker with -map, sorted by address
+class SymbolMap{
+private:
+  vector<MappedSymbol> symbols;
+
+  //last symbol at or below address a that is accepted by the filter, nullptr if there is none
+  template<class Filter>
+  const MappedSymbol* find_below(uint32_t a, Filter accept) const;
+
+public:
+  SymbolMap(const string& filename);
+
+  inline size_t get_size() const {return this->symbols.size();}
+
+  //closest symbol of any kind, labels inside a routine included
+  const MappedSymbol* find_symbol(uint32_t a) const;
+  //routine the address belongs to, the closest global symbol, or the section when no global precedes it
+  const MappedSymbol* find_routine(uint32_t a) const;
+
+  //name+0xOFFSET form of an address, or the bare address when no symbol precedes it
+  string describe(uint32_t a) const;
+};
+
+#endif
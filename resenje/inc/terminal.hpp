@@ -0,0 +1,71 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include "memory.hpp"
+#include "ringBuffer.hpp"
+
+//terminal device from the spec
+//term_out: a character written here is printed, term_in: the last received character
+//an I/O thread reads the host stdin into the input ring and writes the output ring to stdout,
+//so the emulation thread never blocks on the host and characters reach stdout in batches
+class Terminal: public MmioDevice{
+public:
+  enum Mode{
+    INTERACTIVE,    //host stdin and stdout
+    OUTPUT_ONLY,    //stdin is left to someone else (the debugger), the guest gets no input
+    DETACHED        //no host side at all (batch instances), output is kept in memory
+  };
+
+  static const uint32_t TERM_OUT = 0xFFFFFF00;
+  static const uint32_t TERM_IN = 0xFFFFFF04;
+  static const uint32_t REGISTERS_SIZE = 8;
+
+private:
+  static const size_t INPUT_RING_BITS = 12;
+  static const size_t OUTPUT_RING_BITS = 16;
+  static const int POLL_INTERVAL_MS = 10;
+
+  Memory* memory;
+  RingBuffer input;         //host stdin to the guest, filled by the I/O thread
+  RingBuffer output;        //guest to the host stdout, drained by the I/O thread
+  std::thread io;
+  std::atomic<bool> stopping;
+  Mode mode;
+  std::string captured;     //output of a detached terminal
+  std::string queued;       //input of a detached terminal, given by the program that drives it
+  size_t queued_position;   //next character of queued
+
+  void run_io();
+  void write_output();
+
+public:
+  Terminal(Memory* m, Mode mode = INTERACTIVE);
+  ~Terminal();
+
+  Terminal(const Terminal&) = delete;
+  Terminal& operator=(const Terminal&) = delete;
+
+  //checked by the cores, so it has to stay a couple of loads
+  inline bool has_input() const {
+    return this->mode == DETACHED ? this->queued_position < this->queued.size() : !this->input.empty();
+  }
+
+  //moves the next received character into term_in and returns it
+  uint8_t receive();
+  //puts a character into term_in as if it was received, for replayed input
+  void deliver(uint8_t character);
+  //input of a detached terminal, received a character at a time like typed input
+  void send(const std::string& text);
+  //output of n bytes at once, as if they were written into term_out one by one
+  void print(const uint8_t* bytes, size_t n);
+  //returns once everything the guest printed reached stdout
+  void flush();
+  inline const std::string& get_captured() const {return this->captured;}
+
+  void mmio_written(uint32_t address, uint32_t size) override;
+};
+
+#endif
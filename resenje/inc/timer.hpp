@@ -0,0 +1,60 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "memory.hpp"
+
+//timer device from the spec, tim_cfg selects the period of the timer interrupt
+//time is virtual, one retired instruction is one cycle of a processor running at frequency_mhz,
+//so runs are reproducible and the cores only compare the instruction count with a deadline
+//the timer belongs to hart 0, a tim_cfg write by another hart is applied by hart 0 between its blocks, see update
+class Timer: public MmioDevice{
+public:
+  static const uint32_t TIM_CFG = 0xFFFFFF10;
+  static const uint32_t REGISTERS_SIZE = 4;
+
+private:
+  static const uint32_t PERIODS_MS[8];
+
+  Memory* memory;
+  uint64_t instructions_per_ms;
+  bool realtime;              //never run ahead of the host clock
+  const uint64_t* clock;      //retired instructions of hart 0
+  uint64_t* next_event;       //of hart 0, pulled to 0 on a tim_cfg write so the new deadline is scheduled
+  uint64_t period;
+  uint64_t deadline;
+  std::thread::id owner;      //thread hart 0 runs on, none before its first run
+  std::atomic<bool> written;  //tim_cfg was written by another hart and is not applied yet
+
+  //start of the run, for pacing
+  uint64_t start_clock;
+  std::chrono::steady_clock::time_point start_time;
+
+  void configure(uint32_t cfg);
+
+public:
+  Timer(Memory* m, uint32_t frequency_mhz, bool realtime, const uint64_t* clock, uint64_t* next_event);
+
+  Timer(const Timer&) = delete;
+  Timer& operator=(const Timer&) = delete;
+
+  inline uint64_t get_deadline() const {return this->deadline;}
+  inline void set_owner(std::thread::id t){this->owner = t;}
+
+  //tim_cfg is 0 after reset and the timer is always running
+  void reset();
+  //continues a stored run, tim_cfg is already in memory
+  void restore(uint64_t remaining);
+  //applies a tim_cfg write of another hart, called by hart 0 between blocks
+  void update();
+  //true once per period, the caller raises the interrupt
+  bool expired();
+  //sleeps while virtual time is ahead of the host clock, only in realtime mode
+  void pace();
+
+  void mmio_written(uint32_t address, uint32_t size) override;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "decodeCache.hpp"
+
+class Emulator;
+
+//trace policies, the interpreter cores are templates over one of them
+//hooks are static and inline, so with NoTrace the cores contain no tracing code at all
+
+//enabled policies hook every instruction and keep the JIT off, breakpoints policies look at every block entry
+
+//production policy, nothing is recorded
+struct NoTrace{
+  static const bool enabled = false;
+  static const bool breakpoints = false;
+  static inline void before(Emulator* e, const DecodedInstruction& d){}
+  static inline void after(Emulator* e){}
+};
+
+//full text trace into emulation.txt, registers before every instruction followed by the instruction itself
+struct TextTrace{
+  static const bool enabled = true;
+  static const bool breakpoints = false;
+  static void before(Emulator* e, const DecodedInstruction& d);
+  static inline void after(Emulator* e){}
+};
+
+//compact binary trace into emulation.trace, written by a background thread, tracedump turns it back into text
+struct BinaryTrace{
+  static const bool enabled = true;
+  static const bool breakpoints = false;
+  static void before(Emulator* e, const DecodedInstruction& d);
+  static void after(Emulator* e);
+};
+
+//retired instruction count per pc for --profile, reported at exit
+struct ProfileTrace{
+  static const bool enabled = true;
+  static const bool breakpoints = false;
+  static void before(Emulator* e, const DecodedInstruction& d);
+  static inline void after(Emulator* e){}
+};
+
+//--debug, no per instruction hooks so blocks may still be compiled, the debugger is consulted at block entry
+struct DebugTrace{
+  static const bool enabled = false;
+  static const bool breakpoints = true;
+  static inline void before(Emulator* e, const DecodedInstruction& d){}
+  static inline void after(Emulator* e){}
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef TRACEDUMP_H
+#define TRACEDUMP_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "cpuContext.hpp"
+#include "traceWriter.hpp"
+using namespace std;
+
+//turns a binary trace written by the emulator back into text
+//register state is rebuilt by replaying the recorded changes from the start of the file
+class TraceDump{
+private:
+  FILE* input_file;
+  ostream* output;
+  bool registers;     //full register dump per instruction, same layout as the emulator's text trace
+  CpuContext context;
+  uint64_t index;
+
+  bool read_bytes(uint8_t* bytes, size_t n);
+  bool read32(uint32_t* v);
+  void check_header();
+  void print_registers(uint32_t pc);
+  void dump();
+
+public:
+  TraceDump(const string& filename, ostream* output, bool registers);
+  ~TraceDump();
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include "cpuContext.hpp"
+#include "decodeCache.hpp"
+#include "memory.hpp"
+#include "ringBuffer.hpp"
+using namespace std;
+
+//binary execution trace file
+//header: magic "EMUTRACE", u32 version
+//record: u32 pc, u32 instruction word, u32 changed mask, u8 memory write count, then
+//        u32 value of every changed register in mask order (bits 0-15 gpr, bits 16-18 csr), then
+//        u32 address, u32 value of every memory write
+//a record with the write count RESET_MARKER starts a new run, all registers are 0 and pc is the record pc
+//a record with the write count INTERRUPT_MARKER is an interrupt taken before the instruction at pc,
+//the instruction word is the cause, the changed registers follow and then the two words pushed, status and pc
+//all fields are little endian
+struct TraceFormat{
+  static constexpr const char* MAGIC = "EMUTRACE";
+  static const uint32_t MAGIC_SIZE = 8;
+  static const uint32_t VERSION = 2;
+  static const uint32_t HEADER_SIZE = 13;
+  static const uint8_t RESET_MARKER = 0xFF;
+  static const uint8_t INTERRUPT_MARKER = 0xFE;
+  static const uint32_t MAX_WRITES = 2;
+  static const uint32_t REGISTER_COUNT = 19;
+  static const uint32_t MAX_RECORD_SIZE = HEADER_SIZE + 4 * REGISTER_COUNT + 8 * MAX_WRITES;
+};
+
+//builds binary trace records on the emulation thread and hands them to a writer thread through a ring buffer
+//register changes are found by comparing with a copy taken before the instruction,
+//memory writes by the addresses the instruction is going to store to
+class TraceWriter{
+private:
+  static const size_t RING_BITS = 22;
+
+  RingBuffer ring;
+  FILE* file;
+  std::thread writer;
+  std::atomic<bool> stopping;
+
+  //state of the record being built
+  CpuContext before;
+  uint32_t pc;
+  uint32_t raw;
+  uint32_t write_addresses[TraceFormat::MAX_WRITES];
+  uint8_t write_count;
+  uint8_t marker;     //write count stored in the record, INTERRUPT_MARKER for an interrupt
+
+  static inline uint8_t* put32(uint8_t* p, uint32_t v){
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    return p + 4;
+  }
+
+  void drain();
+
+public:
+  TraceWriter(const string& filename);
+  ~TraceWriter();
+
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+
+  void reset(uint32_t pc);
+  void begin(uint32_t pc, const DecodedInstruction& d, const CpuContext& c, const Memory* m);
+  void end(const CpuContext& c, const Memory* m);
+  //an interrupt is recorded as an instruction, begun before the pushes and ended once the handler address is in pc
+  void begin_interrupt(uint32_t cause, const CpuContext& c);
+};
+
+#endif
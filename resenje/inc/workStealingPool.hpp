@@ -0,0 +1,120 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+using namespace std;
+
+//runs tasks 0 to N-1 on a fixed number of worker threads
+//tasks are dealt round-robin into one deque per worker, a worker takes its own work from the back
+//and, once its deque is empty, steals from the front of the others, so long jobs do not leave threads idle
+//tasks run in slices go back to the front of the deque of the worker that ran the slice, behind its other tasks,
+//so a worker takes turns among its tasks and the one it just ran is the first the others steal
+class WorkStealingPool{
+private:
+  struct Worker{
+    std::mutex lock;
+    deque<size_t> tasks;
+  };
+
+  vector<Worker> workers;
+  std::atomic<size_t> unfinished;   //tasks dealt and not yet done, a slice in flight may still come back
+  //idle workers of a sliced run sleep here until a task is put back or the last one is done
+  std::mutex idle_lock;
+  std::condition_variable idle;
+  std::atomic<size_t> put_backs;    //changed under idle_lock, a worker that saw it before looking knows when to look again
+
+  bool take_own(size_t w, size_t& task){
+    std::lock_guard<std::mutex> guard(this->workers[w].lock);
+    if(this->workers[w].tasks.empty()) return false;
+    task = this->workers[w].tasks.back();
+    this->workers[w].tasks.pop_back();
+    return true;
+  }
+
+  bool steal(size_t w, size_t& task){
+    for(size_t i = 1 ; i < this->workers.size() ; ++i){
+      Worker& victim = this->workers[(w + i) % this->workers.size()];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if(victim.tasks.empty()) continue;
+      task = victim.tasks.front();
+      victim.tasks.pop_front();
+      return true;
+    }
+    return false;
+  }
+
+  void put_back(size_t w, size_t task){
+    {
+      std::lock_guard<std::mutex> guard(this->workers[w].lock);
+      this->workers[w].tasks.push_front(task);
+    }
+    {
+      std::lock_guard<std::mutex> guard(this->idle_lock);
+      this->put_backs.fetch_add(1, std::memory_order_release);
+    }
+    this->idle.notify_one();
+  }
+
+  void finish(){
+    if(this->unfinished.fetch_sub(1, std::memory_order_release) != 1) return;
+    //taken so a worker between its look at unfinished and its wait does not miss the notification
+    {
+      std::lock_guard<std::mutex> guard(this->idle_lock);
+    }
+    this->idle.notify_all();
+  }
+
+  //no task is ever added while running, once every deque is empty the worker is done,
+  //unless tasks run in slices: those running elsewhere may come back, so it sleeps until one does
+  void work(size_t w, const std::function<bool(size_t)>& slice, bool slices){
+    size_t task;
+    while(this->unfinished.load(std::memory_order_acquire) != 0){
+      size_t seen = this->put_backs.load(std::memory_order_acquire);
+      if(!this->take_own(w, task) && !this->steal(w, task)){
+        if(!slices) return;
+        std::unique_lock<std::mutex> guard(this->idle_lock);
+        this->idle.wait(guard, [this, seen]{
+          return this->put_backs.load(std::memory_order_acquire) != seen || this->unfinished.load(std::memory_order_acquire) == 0;
+        });
+        continue;
+      }
+      if(slice(task)) this->put_back(w, task);
+      else this->finish();
+    }
+  }
+
+  void start(size_t task_count, const std::function<bool(size_t)>& slice, bool slices){
+    //dealt in reverse so every worker starts with its lowest task
+    for(size_t t = task_count ; t-- > 0 ; ) this->workers[t % this->workers.size()].tasks.push_back(t);
+    this->unfinished.store(task_count, std::memory_order_relaxed);
+    this->put_backs.store(0, std::memory_order_relaxed);
+    vector<std::thread> threads;
+    for(size_t w = 1 ; w < this->workers.size() ; ++w) threads.push_back(std::thread(&WorkStealingPool::work, this, w, std::cref(slice), slices));
+    this->work(0, slice, slices);
+    for(size_t i = 0 ; i < threads.size() ; ++i) threads[i].join();
+  }
+
+public:
+  WorkStealingPool(size_t threads): workers(threads == 0 ? 1 : threads){}
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  //returns once every task has run, worker 0 is the calling thread
+  void run(size_t task_count, const std::function<void(size_t)>& run){
+    this->start(task_count, [&run](size_t task) {run(task); return false;}, false);
+  }
+
+  //slice runs a part of the task and returns true while there is more of it, returns once every task is done
+  void run_slices(size_t task_count, const std::function<bool(size_t)>& slice){
+    this->start(task_count, slice, true);
+  }
+};
+
+#endif
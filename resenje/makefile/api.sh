@@ -0,0 +1,12 @@
+ASSEMBLER=./assembler
+LINKER=./linker
+
+# usage, from the build directory after makefile.sh: bash ../makefile/api.sh
+# tests/api/run_for.cpp is linked with libemu.a and runs tests/input/echo.s with its input sent through the interface,
+# unsliced, with run_for in slices of 1 to 5000 instructions and with step, the runs have to end the same on every core
+
+${ASSEMBLER} -o api_echo.o ../tests/input/echo.s || exit 1
+${LINKER} -hex -place=echo@0x40000000 -o api_echo.hex api_echo.o || exit 1
+g++ -O2 -pthread -o api_run_for ../tests/api/run_for.cpp libemu.a || exit 1
+
+./api_run_for api_echo.hex
@@ -0,0 +1,56 @@
+ASSEMBLER=./assembler
+LINKER=./linker
+EMULATOR=./emulator
+JOBS=4
+
+# usage, from the build directory after makefile.sh: bash ../makefile/batch.sh
+# semihost_files.s run alone writes batch_semihost.txt and reads it back,
+# run as concurrent batch jobs, with and without --quantum, every job has to get ERROR and no file may be written
+# input/echo.s waits for terminal input given with input=, sliced by any --quantum its jobs have to end as the unsliced ones
+
+${ASSEMBLER} -o batch_semihost_files.o ../tests/batch/semihost_files.s || exit 1
+${LINKER} -hex -place=batch@0x40000000 -o batch_semihost_files.hex batch_semihost_files.o || exit 1
+
+FAILED=0
+rm -f batch_semihost.txt
+OUTPUT=$(${EMULATOR} batch_semihost_files.hex </dev/null)
+if echo "${OUTPUT}" | grep -q "r8=0x00000008.*r9=0x00000008" && [ "$(cat batch_semihost.txt)" = "written" ]; then
+  echo "semihost_files alone: ok"
+else
+  echo "semihost_files alone: failed: ${OUTPUT}"
+  FAILED=1
+fi
+
+rm -f batch_semihost.txt batch_jobs.txt
+for i in $(seq 1 ${JOBS}); do echo "batch_semihost_files.hex" >> batch_jobs.txt; done
+for MODE in "" "--quantum=5"; do
+  OUTPUT=$(${EMULATOR} --batch batch_jobs.txt -j ${JOBS} ${MODE} </dev/null)
+  ERRORS=$(echo "${OUTPUT}" | grep -c "halted.*r8=0xffffffff r9=0xffffffff")
+  if [ "${ERRORS}" -eq ${JOBS} ] && [ ! -e batch_semihost.txt ]; then
+    echo "semihost_files batch ${MODE}: ok"
+  else
+    echo "semihost_files batch ${MODE}: failed: ${OUTPUT}"
+    FAILED=1
+  fi
+  rm -f batch_semihost.txt
+done
+
+${ASSEMBLER} -o batch_echo.o ../tests/input/echo.s || exit 1
+${LINKER} -hex -place=echo@0x40000000 -o batch_echo.hex batch_echo.o || exit 1
+printf "hello" > batch_echo_input.txt
+rm -f batch_echo_jobs.txt
+for i in $(seq 1 ${JOBS}); do echo "batch_echo.hex input=batch_echo_input.txt" >> batch_echo_jobs.txt; done
+# the jobs end in any order and take different times, only the sorted summaries without the time are compared
+UNSLICED=$(${EMULATOR} --batch batch_echo_jobs.txt -j 2 </dev/null | sed 's/, [0-9.]* ms//' | sort)
+for MODE in "--quantum=7" "--quantum=100" "--quantum=5000"; do
+  SLICED=$(${EMULATOR} --batch batch_echo_jobs.txt -j 2 ${MODE} </dev/null | sed 's/, [0-9.]* ms//' | sort)
+  if [ "${SLICED}" = "${UNSLICED}" ] && [ $(echo "${SLICED}" | grep -c 'halted.*r8=0x214.*output="hello"') -eq ${JOBS} ]; then
+    echo "echo batch ${MODE}: ok"
+  else
+    echo "echo batch ${MODE}: failed:"
+    echo "unsliced:"; echo "${UNSLICED}"
+    echo "sliced:"; echo "${SLICED}"
+    FAILED=1
+  fi
+done
+exit ${FAILED}
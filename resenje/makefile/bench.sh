@@ -0,0 +1,28 @@
+ASSEMBLER=./assembler
+LINKER=./linker
+EMULATOR=./emulator
+REPEAT=${1:-10}
+CORES=${CORES:-"threaded block jit"}
+WORKLOADS="alu memcpy recursion branches interrupts"
+
+# usage, from the build directory after makefile.sh: bash ../makefile/bench.sh [repeat]
+# every workload in tests/bench is a standalone program, run REPEAT times from reset on each core
+# emulated is the time spent in the core as measured by --mips, wall is the whole process including loading
+
+for WORKLOAD in ${WORKLOADS}; do
+  ${ASSEMBLER} -o bench_${WORKLOAD}.o ../tests/bench/${WORKLOAD}.s || exit 1
+  ${LINKER} -hex -place=bench@0x40000000 -o bench_${WORKLOAD}.hex bench_${WORKLOAD}.o || exit 1
+done
+
+printf "%-12s %-10s %14s %12s %12s %10s\n" "WORKLOAD" "CORE" "INSTRUCTIONS" "EMULATED ms" "WALL ms" "MIPS"
+for WORKLOAD in ${WORKLOADS}; do
+  for CORE in ${CORES}; do
+    START=$(date +%s%N)
+    # "<core> core executed N instructions in T ms, M MIPS"
+    RESULT=$(${EMULATOR} --core=${CORE} --mips --repeat=${REPEAT} bench_${WORKLOAD}.hex </dev/null | tail -1)
+    END=$(date +%s%N)
+    echo "${RESULT}" | awk -v workload=${WORKLOAD} -v core=${CORE} -v wall=$(( (END - START) / 1000000 )) \
+      '$3 == "executed" {printf "%-12s %-10s %14s %12s %12s %10s\n", workload, core, $4, $7, wall, $9; found = 1}
+       END {if(!found) printf "%-12s %-10s failed: %s\n", workload, core, $0}'
+  done
+done
@@ -0,0 +1,40 @@
+ASSEMBLER=./assembler
+LINKER=./linker
+EMULATOR=./emulator
+CORES=${CORES:-"threaded block jit"}
+
+# usage, from the build directory after makefile.sh: bash ../makefile/debug.sh
+# tests/input/echo.s is run under --debug with the commands in tests/input/echo_debug.txt:
+# a breakpoint in the handler, a memory dump, steps, a watchpoint on term_out, then the run continues to the halt
+# the input is sent once the guest set its handler and waits, an interrupt before that would go to address 0
+
+${ASSEMBLER} -o debug_echo.o ../tests/input/echo.s || exit 1
+${LINKER} -hex -place=echo@0x40000000 -o debug_echo.hex debug_echo.o || exit 1
+
+EXPECTED="Stopped, at a breakpoint.
+40000034:	PUSH r14 += -4; mem[r14] <= r1
+ffffff04: 00000068
+40000048:	LD r2 <= 0xffffff00
+r0=0x00000000	r1=0x00000068
+Stopped, watchpoint 0xffffff00 written at 0xffffff00, word there is now 0x68.
+breakpoint 0x40000034
+watchpoint 0xffffff00, 4 bytes
+Emulated processor executed halt instruction.
+r8=0x00000214"
+
+FAILED=0
+for CORE in ${CORES}; do
+  OUTPUT=$( (sleep 1; printf "hello") | timeout 20 ${EMULATOR} --core=${CORE} --debug=../tests/input/echo_debug.txt debug_echo.hex 2>&1)
+  STATUS=$?
+  MISSING=""
+  while IFS= read -r LINE; do
+    echo "${OUTPUT}" | grep -qF "${LINE}" || MISSING="${MISSING}${LINE}\n"
+  done <<< "${EXPECTED}"
+  if [ ${STATUS} -eq 0 ] && [ -z "${MISSING}" ]; then
+    printf "%-20s %-10s ok\n" echo ${CORE}
+  else
+    printf "%-20s %-10s failed, exit %d, missing:\n${MISSING}%s\n" echo ${CORE} ${STATUS} "${OUTPUT}"
+    FAILED=1
+  fi
+done
+exit ${FAILED}
@@ -0,0 +1,27 @@
+ASSEMBLER=./assembler
+LINKER=./linker
+EMULATOR=./emulator
+CORES=${CORES:-"threaded block jit"}
+
+# usage, from the build directory after makefile.sh: bash ../makefile/faults.sh
+# every program in tests/faults stops the emulator with an error, the "# expected:" line of its source is the message
+# each core has to print that message and exit normally, a crash or any other message fails the program
+
+FAILED=0
+for SOURCE in ../tests/faults/*.s; do
+  NAME=$(basename ${SOURCE} .s)
+  EXPECTED=$(sed -n 's/^# expected: //p' ${SOURCE})
+  ${ASSEMBLER} -o fault_${NAME}.o ${SOURCE} || exit 1
+  ${LINKER} -hex -place=fault@0x40000000 -o fault_${NAME}.hex fault_${NAME}.o || exit 1
+  for CORE in ${CORES}; do
+    OUTPUT=$(${EMULATOR} --core=${CORE} fault_${NAME}.hex </dev/null 2>&1)
+    STATUS=$?
+    if [ ${STATUS} -eq 0 ] && echo "${OUTPUT}" | grep -qxF "${EXPECTED}"; then
+      printf "%-20s %-10s ok\n" ${NAME} ${CORE}
+    else
+      printf "%-20s %-10s failed, exit %d: %s\n" ${NAME} ${CORE} ${STATUS} "${OUTPUT}"
+      FAILED=1
+    fi
+  done
+done
+exit ${FAILED}
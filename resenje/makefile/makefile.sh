@@ -1,3 +1,5 @@
 g++ -o assembler ../src/mainAssembler.cpp
 g++ -o linker  ../src/mainLinker.cpp
-g++ -o emulator  ../src/mainEmulator.cpp
\ No newline at end of file
+g++ -O2 -pthread -o emulator  ../src/mainEmulator.cpp
+g++ -O2 -pthread -c -o libemu.o ../src/libemu.cpp && ar rcs libemu.a libemu.o
+g++ -O2 -o tracedump  ../src/mainTracedump.cpp
\ No newline at end of file
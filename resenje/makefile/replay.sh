@@ -0,0 +1,27 @@
+ASSEMBLER=./assembler
+LINKER=./linker
+EMULATOR=./emulator
+CORES=${CORES:-"threaded block jit"}
+
+# usage, from the build directory after makefile.sh: bash ../makefile/replay.sh
+# tests/input/echo.s is run with its input piped in and --record, then with --replay and no input at all
+# on each core the replayed run has to end in the same state after the same number of instructions, without diverging
+# a replay that loses the input leaves the guest waiting forever, so it gets a time limit
+
+${ASSEMBLER} -o replay_echo.o ../tests/input/echo.s || exit 1
+${LINKER} -hex -place=echo@0x40000000 -o replay_echo.hex replay_echo.o || exit 1
+
+FAILED=0
+for CORE in ${CORES}; do
+  rm -f replay_echo.log
+  # the time and the MIPS differ between the runs, the instruction count may not
+  RECORDED=$(printf "hello" | ${EMULATOR} --core=${CORE} --mips --record=replay_echo.log replay_echo.hex 2>&1 | sed 's/ in [0-9.]* ms.*//')
+  REPLAYED=$(timeout 20 ${EMULATOR} --core=${CORE} --mips --replay=replay_echo.log replay_echo.hex </dev/null 2>&1 | sed 's/ in [0-9.]* ms.*//')
+  if [ -s replay_echo.log ] && [ "${RECORDED}" = "${REPLAYED}" ] && echo "${REPLAYED}" | grep -q "^hello"; then
+    printf "%-20s %-10s ok\n" echo ${CORE}
+  else
+    printf "%-20s %-10s failed\nrecorded:\n%s\nreplayed:\n%s\n" echo ${CORE} "${RECORDED}" "${REPLAYED}"
+    FAILED=1
+  fi
+done
+exit ${FAILED}
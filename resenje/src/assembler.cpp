@@ -379,8 +379,26 @@ int Assembler::first_pass(){
 
           cleaned_line = clean_line(cleaned_line);  //removes blanco spaces before %gpr1, %gpr2
 
+          //xchg [%gpr1 + literal], %gpr2 swaps a register with memory
+          if(code == 11 && !cleaned_line.empty() && cleaned_line[0] == '[')
+          {
+            size_t position_bracket = cleaned_line.find(']');
+            if(position_bracket == string::npos) throw ExceptionAlert("Missing ] in xchg operand: " + cleaned_line);
+            string address = cleaned_line.substr(1, position_bracket - 1);
+            size_t position_plus = address.find('+');
+            string displacement = position_plus == string::npos ? "0" : clean_line(address.substr(position_plus + 1));
+            address = position_plus == string::npos ? address : address.substr(0, position_plus);
+            displacement.erase(displacement.find_last_not_of(" \t") + 1);
+            address.erase(address.find_last_not_of(" \t") + 1);
+
+            this->parseRegisters(address + cleaned_line.substr(position_bracket + 1), gpr1, gpr2);
+            new_operation->set_gpr1(gpr1);
+            new_operation->set_gpr2(gpr2);
+            new_operation->set_operand(displacement);
+            new_operation->set_operand_type(Operation::REG_LITERAL_MEM);
+          }
           //normal add instruction
-          if(cleaned_line.find("sh") == string::npos)
+          else if(cleaned_line.find("sh") == string::npos)
           {
             this->parseRegisters(cleaned_line, gpr1, gpr2);
 
@@ -1618,12 +1636,28 @@ void Assembler::operation_xchg(Operation* p){
   int registerNo2 = this->registers.at(p->get_gpr2());
   p->machine_code = (std::bitset<32>("01000000000000000000000000000000"));
 
+  //xchg [%gpr1 + literal], %gpr2 - 0100 0001 - 0000 gpr1 - gpr2 literal
+  if(p->get_operand_type() == Operation::REG_LITERAL_MEM){
+    string operandNoValue = p->get_operand();
+    int literal_value = 0;
+    if(this->is_number(operandNoValue)) literal_value = this->string_to_int(operandNoValue);
+    else if(this->is_binary(operandNoValue)) literal_value = this->binary_to_int(operandNoValue);
+    else if(this->is_hex(operandNoValue)) literal_value = this->hex_to_int(operandNoValue);
+    else throw ExceptionAlert("Displacement of xchg must be a literal: " + operandNoValue);
+    if(literal_value < -2048 || literal_value >= 2048) throw ExceptionAlert("Displacement of xchg does not fit in 12 bits: " + operandNoValue);
+    p->machine_code = (std::bitset<32>("01000001000000000000000000000000"));
+    std::string literal_binary_value = std::bitset<12>(literal_value).to_string();
+    for (int i = 0; i < 12; ++i) {
+      if (literal_binary_value[i] == '1') p->machine_code.set(11 - i);
+    }
+  }
+
   std::string register_binary_value = std::bitset<4>(registerNo1).to_string();
   for (int i = 0; i < 4; ++i) {
     if (register_binary_value[i] == '1') {
-        p->machine_code.set(17 - i); // Set the corresponding bit to 1
+        p->machine_code.set(19 - i); // Set the corresponding bit to 1
     } else {
-        p->machine_code.reset(17 - i); // Set the corresponding bit to 0
+        p->machine_code.reset(19 - i); // Set the corresponding bit to 0
     }
   }
 
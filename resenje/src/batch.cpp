@@ -0,0 +1,207 @@
+#include "../inc/batch.hpp"
+#include "../inc/workStealingPool.hpp"
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+BatchRunner::BatchRunner(const string& jobs_file, EmulatorOptions o, uint threads, uint64_t quantum){
+  this->options = o;
+  this->options.detached = true;
+  this->threads = threads == 0 ? 1 : threads;
+  this->quantum = quantum;
+  if(quantum != 0 && o.harts > 1) throw ExceptionAlert("Only jobs with one hart can be time-sliced.");
+  this->failed = 0;
+  this->parse_jobs(jobs_file);
+  try{
+    for(size_t i = 0 ; i < this->jobs.size() ; ++i){
+      const string& image = this->jobs[i].image;
+      if(this->templates.count(image) == 0) this->templates[image] = new ImageTemplate(image);
+    }
+  }
+  catch(...){
+    for(auto it = this->templates.begin() ; it != this->templates.end() ; ++it) delete it->second;
+    throw;
+  }
+}
+
+BatchRunner::~BatchRunner(){
+  for(auto it = this->templates.begin() ; it != this->templates.end() ; ++it) delete it->second;
+}
+
+void BatchRunner::parse_jobs(const string& jobs_file){
+  ifstream file(jobs_file);
+  if(!file.is_open()) throw ExceptionAlert("Jobs file " + jobs_file + " can not be opened.");
+  string line;
+  uint number = 0;
+  while(std::getline(file, line)){
+    ++number;
+    size_t comment = line.find('#');
+    if(comment != string::npos) line = line.substr(0, comment);
+    if(line.find_first_not_of(" \t\r") == string::npos) continue;
+    this->jobs.push_back(parse_job(line, number));
+  }
+  if(this->jobs.empty()) throw ExceptionAlert("Jobs file " + jobs_file + " has no jobs.");
+}
+
+BatchJob BatchRunner::parse_job(const string& line, uint number){
+  std::istringstream fields(line);
+  BatchJob job;
+  job.line = number;
+  fields >> job.image;
+  if(job.image.find(".hex") == string::npos && job.image.find(".bin") == string::npos){
+    throw ExceptionAlert("Job on line " + std::to_string(number) + " has an unsupported image " + job.image + ".");
+  }
+  string field;
+  while(fields >> field){
+    size_t equals = field.find('=');
+    if(equals == string::npos || equals == 0 || equals + 1 == field.size()){
+      throw ExceptionAlert("Job on line " + std::to_string(number) + " has a malformed override " + field + ".");
+    }
+    string target = field.substr(0, equals);
+    if(target == "input"){
+      ifstream input(field.substr(equals + 1), std::ios::binary);
+      if(!input.is_open()) throw ExceptionAlert("Job on line " + std::to_string(number) + " has an input file that can not be opened: " + field.substr(equals + 1) + ".");
+      std::ostringstream contents;
+      contents << input.rdbuf();
+      job.input = contents.str();
+      continue;
+    }
+    uint32_t value;
+    try{
+      value = static_cast<uint32_t>(std::stoul(field.substr(equals + 1), nullptr, 0));
+    }
+    catch(std::exception&){
+      throw ExceptionAlert("Job on line " + std::to_string(number) + " has a malformed value in " + field + ".");
+    }
+    if(target == "sp") job.registers.push_back({14, value});
+    else if(target == "pc") job.registers.push_back({15, value});
+    else if(target[0] == 'r' && target.size() > 1 && target.find_first_not_of("0123456789", 1) == string::npos){
+      uint32_t r = std::stoul(target.substr(1));
+      if(r > 15) throw ExceptionAlert("Job on line " + std::to_string(number) + " names a register that does not exist: " + target + ".");
+      job.registers.push_back({r, value});
+    }
+    else{
+      uint32_t address;
+      try{
+        address = static_cast<uint32_t>(std::stoul(target, nullptr, 0));
+      }
+      catch(std::exception&){
+        throw ExceptionAlert("Job on line " + std::to_string(number) + " has an override of neither a register nor an address: " + target + ".");
+      }
+      if(address % 4 != 0) throw ExceptionAlert("Job on line " + std::to_string(number) + " overrides an unaligned word at " + target + ".");
+      job.words.push_back({address, value});
+    }
+  }
+  return job;
+}
+
+void BatchRunner::run(){
+  auto start_time = std::chrono::steady_clock::now();
+  if(this->quantum == 0){
+    WorkStealingPool pool(this->threads);
+    pool.run(this->jobs.size(), [this](size_t index) {this->run_job(index);});
+  }
+  else this->run_sliced();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  std::cout << this->jobs.size() << " jobs, " << this->jobs.size() - this->failed << " halted, " << this->failed << " failed, "
+            << std::fixed << std::setprecision(3) << seconds * 1000 << " ms on " << this->threads << " threads\n";
+}
+
+Emulator* BatchRunner::start_job(size_t index, string& failure){
+  const BatchJob& job = this->jobs[index];
+  EmulatorOptions o = this->options;
+  o.shared_image = this->templates[job.image];
+  o.register_overrides = job.registers;
+  o.memory_overrides = job.words;
+  Emulator* emulator = nullptr;
+  try{
+    emulator = new Emulator(job.image, o);
+    //jobs run in slices never go through Emulator::run
+    emulator->check_entry();
+    if(!job.input.empty()) emulator->send_input(job.input);
+    return emulator;
+  }
+  catch(ExceptionAlert& e){
+    failure = e.get_message();
+    delete emulator;
+  }
+  return nullptr;
+}
+
+void BatchRunner::run_job(size_t index){
+  auto start_time = std::chrono::steady_clock::now();
+  string failure = "";
+  Emulator* emulator = this->start_job(index, failure);
+  try{
+    if(emulator != nullptr) emulator->run();
+  }
+  catch(ExceptionAlert& e){
+    failure = e.get_message();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  this->report_job(index, emulator, failure, seconds);
+}
+
+//jobs are reported once all of them are done, each with the host time of its own slices
+void BatchRunner::run_sliced(){
+  InstanceScheduler scheduler(this->quantum);
+  vector<Emulator*> emulators;
+  vector<string> failures;
+  for(size_t index = 0 ; index < this->jobs.size() ; ++index){
+    string failure = "";
+    Emulator* emulator = this->start_job(index, failure);
+    if(emulator != nullptr) scheduler.add(emulator);
+    emulators.push_back(emulator);
+    failures.push_back(failure);
+  }
+  scheduler.run(this->threads);
+  uint32_t id = 0;
+  for(size_t index = 0 ; index < this->jobs.size() ; ++index){
+    double seconds = 0;
+    if(emulators[index] != nullptr){
+      if(scheduler.get_state(id) == InstanceScheduler::FAILED) failures[index] = scheduler.get_failure(id);
+      else if(scheduler.get_state(id) == InstanceScheduler::PARKED) failures[index] = "blocked on terminal input after " + std::to_string(emulators[index]->get_instructions_retired()) + " instructions";
+      seconds = scheduler.get_seconds(id);
+      ++id;
+    }
+    this->report_job(index, emulators[index], failures[index], seconds);
+  }
+}
+
+//takes the emulator, a job with a failure is reported as failed even if it was loaded
+void BatchRunner::report_job(size_t index, Emulator* emulator, const string& failure, double seconds){
+  const BatchJob& job = this->jobs[index];
+  std::ostringstream summary;
+  summary << "job " << index << " line " << job.line << " " << job.image << ": ";
+  bool failed = emulator == nullptr || !failure.empty();
+  if(failed) summary << "failed, " << failure;
+  else{
+    const CpuContext& context = emulator->get_context();
+    if(emulator->has_exited()) summary << "exited with code " << emulator->get_exit_code() << ", ";
+    else summary << "halted, ";
+    summary << emulator->get_instructions_retired() << " instructions, "
+            << std::fixed << std::setprecision(3) << seconds * 1000 << " ms, pc=0x" << std::hex << context.registers[15];
+    //registers that are still 0 are left out, most programs touch only a few
+    for(int i = 0 ; i < 15 ; ++i){
+      if(context.registers[i] != 0) summary << " r" << std::dec << i << "=0x" << std::hex << context.registers[i];
+    }
+    if(!emulator->get_terminal_output().empty()) summary << " output=\"" << escape(emulator->get_terminal_output()) << "\"";
+  }
+  delete emulator;
+
+  std::lock_guard<std::mutex> guard(this->output_lock);
+  if(failed) ++this->failed;
+  std::cout << summary.str() << std::endl;
+}
+
+string BatchRunner::escape(const string& s){
+  std::ostringstream escaped;
+  for(size_t i = 0 ; i < s.size() ; ++i){
+    unsigned char c = s[i];
+    if(c == '\n') escaped << "\\n";
+    else if(c == '"' || c == '\\') escaped << '\\' << c;
+    else if(c < 0x20 || c >= 0x7f) escaped << "\\x" << std::hex << std::setw(2) << std::setfill('0') << (uint)c;
+    else escaped << c;
+  }
+  return escaped.str();
+}
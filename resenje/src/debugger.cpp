@@ -0,0 +1,216 @@
+#include "../inc/debugger.hpp"
+#include "../inc/emulator.hpp"
+#include "../inc/disassembler.hpp"
+#include <sstream>
+
+static bool parse_number(const string& s, uint32_t& v){
+  try{
+    size_t used;
+    unsigned long n = std::stoul(s, &used, 0);
+    if(used != s.size() || n > UINT32_MAX) return false;
+    v = static_cast<uint32_t>(n);
+    return true;
+  }
+  catch(std::exception&){
+    return false;
+  }
+}
+
+static bool parse_register(const string& s, uint32_t& r){
+  if(s == "sp") r = 14;
+  else if(s == "pc") r = 15;
+  else if(s.size() > 1 && s.size() <= 3 && s[0] == 'r' && s.find_first_not_of("0123456789", 1) == string::npos) r = std::stoul(s.substr(1));
+  else return false;
+  return r < 16;
+}
+
+Debugger::Debugger(Emulator* e, uint64_t* next_event, const string& script){
+  this->emulator = e;
+  this->next_event = next_event;
+  this->script = nullptr;
+  this->commands = &std::cin;
+  if(script != ""){
+    this->script = new ifstream(script);
+    if(!this->script->is_open()){
+      delete this->script;
+      throw ExceptionAlert("Debugger script " + script + " can not be opened.");
+    }
+    this->commands = this->script;
+  }
+  this->stop_requested = false;
+  this->resuming = false;
+  this->resume_address = 0;
+  e->memory->set_watch_listener(this);
+}
+
+Debugger::~Debugger(){
+  delete this->script;
+}
+
+void Debugger::request_stop(const string& reason){
+  if(this->commands == nullptr) return;
+  this->stop_requested = true;
+  this->stop_reason = reason;
+  __atomic_store_n(this->next_event, 0, __ATOMIC_RELAXED);
+}
+
+void Debugger::stop(const string& reason){
+  this->stop_requested = false;
+  if(this->commands == nullptr) return;
+  this->emulator->terminal->flush();
+  std::cout << "Stopped, " << reason << ".\n";
+  this->print_location();
+  string line;
+  while(true){
+    if(this->script == nullptr) std::cout << "(emu) " << std::flush;
+    if(!std::getline(*this->commands, line)){
+      this->detach();
+      break;
+    }
+    if(this->script != nullptr && line.find_first_not_of(" \t\r") != string::npos) std::cout << "(emu) " << line << "\n";
+    if(!this->execute(line)) break;
+  }
+  this->resuming = true;
+  this->resume_address = this->emulator->context.registers[0xF];
+}
+
+//once the commands run out nothing stops the run anymore
+void Debugger::detach(){
+  for(size_t i = 0 ; i < this->watches.size() ; ++i) this->flag_pages(this->watches[i], false);
+  this->watches.clear();
+  this->breakpoints.clear();
+  this->commands = nullptr;
+}
+
+//blocks that contain the address are dropped, the next translation cuts them at it
+void Debugger::add_breakpoint(uint32_t a){
+  this->breakpoints.insert(a);
+  this->emulator->block_cache->code_written(a, 4);
+}
+
+void Debugger::flag_pages(const Watch& w, bool set){
+  uint32_t last_page = (w.address + w.size - 1) >> Memory::PAGE_BITS;
+  for(uint32_t page = w.address >> Memory::PAGE_BITS ; ; ++page){
+    if(set) this->emulator->memory->set_page_flags(page << Memory::PAGE_BITS, Memory::PAGE_WATCH);
+    else this->emulator->memory->clear_page_flags(page << Memory::PAGE_BITS, Memory::PAGE_WATCH);
+    if(page == last_page) break;
+  }
+}
+
+void Debugger::add_watch(uint32_t a, uint32_t size){
+  this->watches.push_back({a, size});
+  this->flag_pages(this->watches.back(), true);
+}
+
+//pages keep the flag while another watch is on them
+void Debugger::remove_watch(uint32_t a){
+  for(size_t i = 0 ; i < this->watches.size() ; ++i){
+    if(this->watches[i].address != a) continue;
+    this->flag_pages(this->watches[i], false);
+    this->watches.erase(this->watches.begin() + i);
+    for(size_t j = 0 ; j < this->watches.size() ; ++j) this->flag_pages(this->watches[j], true);
+    return;
+  }
+  std::cout << "No watchpoint at 0x" << std::hex << a << std::dec << ".\n";
+}
+
+void Debugger::print_location(){
+  uint32_t pc = this->emulator->context.registers[0xF];
+  std::cout << std::hex << std::setw(8) << std::setfill('0') << pc << std::dec << ":\t"
+            << describe_instruction(this->emulator->decode_cache->fetch(pc))
+            << "\t(" << this->emulator->instructions_retired << " instructions retired)\n";
+}
+
+void Debugger::print_memory(uint32_t a, uint32_t count){
+  for(uint32_t i = 0 ; i < count ; ++i){
+    if(i % 4 == 0) std::cout << (i == 0 ? "" : "\n") << std::hex << std::setw(8) << std::setfill('0') << a + 4 * i << ":";
+    std::cout << " " << std::hex << std::setw(8) << std::setfill('0') << this->emulator->memory->read_word(a + 4 * i);
+  }
+  std::cout << std::dec << "\n";
+}
+
+bool Debugger::execute(const string& line){
+  std::istringstream fields(line.substr(0, line.find('#')));
+  vector<string> words;
+  string word;
+  while(fields >> word) words.push_back(word);
+  if(words.empty()) return true;
+
+  const string& command = words[0];
+  uint32_t a = 0, n = 0;
+  if((command == "break" || command == "b") && words.size() == 2 && parse_number(words[1], a)) this->add_breakpoint(a);
+  else if((command == "delete" || command == "d") && words.size() == 2 && parse_number(words[1], a)){
+    if(this->breakpoints.erase(a) == 0) std::cout << "No breakpoint at 0x" << std::hex << a << std::dec << ".\n";
+  }
+  else if(command == "watch" && (words.size() == 2 || words.size() == 3) && parse_number(words[1], a)){
+    n = 4;
+    if(words.size() == 3 && (!parse_number(words[2], n) || n == 0)){
+      std::cout << "Watchpoint size must be a positive number.\n";
+      return true;
+    }
+    this->add_watch(a, n);
+  }
+  else if(command == "unwatch" && words.size() == 2 && parse_number(words[1], a)) this->remove_watch(a);
+  else if(command == "info" && words.size() == 1){
+    for(auto it = this->breakpoints.begin() ; it != this->breakpoints.end() ; ++it) std::cout << "breakpoint 0x" << std::hex << *it << std::dec << "\n";
+    for(size_t i = 0 ; i < this->watches.size() ; ++i){
+      std::cout << "watchpoint 0x" << std::hex << this->watches[i].address << std::dec << ", " << this->watches[i].size << " bytes\n";
+    }
+  }
+  else if((command == "regs" || command == "r") && words.size() == 1){
+    this->emulator->print_registers();
+    const uint32_t* csr = this->emulator->context.status_registers;
+    std::cout << std::hex << "status=0x" << csr[0] << "\thandler=0x" << csr[1] << "\tcause=0x" << csr[2] << std::dec << "\n";
+  }
+  else if(command == "x" && (words.size() == 2 || words.size() == 3) && parse_number(words[1], a)){
+    n = 1;
+    if(words.size() == 3 && !parse_number(words[2], n)){
+      std::cout << "Word count must be a number.\n";
+      return true;
+    }
+    this->print_memory(a, n);
+  }
+  else if(command == "set" && words.size() == 3 && parse_register(words[1], a) && parse_number(words[2], n)){
+    this->emulator->context.registers[a] = n;
+  }
+  //steps run one instruction at a time, devices and interrupts are not serviced in between
+  else if((command == "step" || command == "s") && words.size() <= 2){
+    n = 1;
+    if(words.size() == 2 && !parse_number(words[1], n)){
+      std::cout << "Step count must be a number.\n";
+      return true;
+    }
+    for(uint32_t i = 0 ; i < n && this->emulator->running && !this->stop_requested ; ++i) this->emulator->step_instruction();
+    if(!this->emulator->running) return false;
+    if(this->stop_requested) std::cout << "Stopped, " << this->stop_reason << ".\n";
+    this->stop_requested = false;
+    this->print_location();
+  }
+  else if((command == "continue" || command == "c") && words.size() == 1) return false;
+  else if((command == "quit" || command == "q") && words.size() == 1) throw ExceptionAlert("Emulation was stopped from the debugger.");
+  else if(command == "help" && words.size() == 1){
+    std::cout << "break ADDR, delete ADDR          pc breakpoints\n"
+              << "watch ADDR [SIZE], unwatch ADDR  stop after a write into SIZE bytes at ADDR, 4 by default\n"
+              << "info                             list breakpoints and watchpoints\n"
+              << "regs                             registers and csrs\n"
+              << "x ADDR [COUNT]                   COUNT memory words from ADDR\n"
+              << "set rN|sp|pc VALUE               change a register\n"
+              << "step [N]                         run N instructions, no interrupts are taken\n"
+              << "continue, quit\n";
+  }
+  else std::cout << "Unknown command " << line << ", help lists the commands.\n";
+  return true;
+}
+
+void Debugger::watched_write(uint32_t address, uint32_t size){
+  for(size_t i = 0 ; i < this->watches.size() ; ++i){
+    const Watch& w = this->watches[i];
+    if(address < w.address + w.size && address + size > w.address){
+      std::ostringstream reason;
+      reason << "watchpoint 0x" << std::hex << w.address << " written at 0x" << address
+             << ", word there is now 0x" << this->emulator->memory->read_word(w.address);
+      this->request_stop(reason.str());
+      return;
+    }
+  }
+}
@@ -0,0 +1,82 @@
+#include "../inc/disassembler.hpp"
+#include <sstream>
+#include <iomanip>
+
+//human readable form of one instruction, used by the text trace
+string describe_instruction(const DecodedInstruction& d){
+  string a = "r" + std::to_string(d.a);
+  string b = "r" + std::to_string(d.b);
+  string c = "r" + std::to_string(d.c);
+  string disp = std::to_string(d.d);
+  std::stringstream literal;
+  literal << "0x" << std::hex << std::setw(8) << std::setfill('0') << d.literal;
+
+  switch(d.macro){
+    case MacroOp::IRET: return "IRET";
+    case MacroOp::LOAD_LITERAL: return "LD " + a + " <= " + literal.str();
+    case MacroOp::CALL_LITERAL: return "CALL pc <= " + literal.str();
+    case MacroOp::BRANCH_LITERAL:{
+      const char* conditions[] = {"", "==", "!=", ">"};
+      uint8_t condition = d.mode & 0x3;
+      if(condition == 0) return "JMP pc <= " + literal.str();
+      return "JMP if " + b + " " + conditions[condition] + " " + c + " then pc <= " + literal.str();
+    }
+  }
+
+  switch(d.opcode){
+    case 0x0: return "HALT";
+    case 0x1: return "INT";
+    case 0x2:
+      if(d.mode == 0x0) return "CALL pc <= " + a + " + " + b + " + " + disp;
+      if(d.mode == 0x1) return "CALL pc <= mem[" + a + " + " + b + " + " + disp + "]";
+      break;
+    case 0x3:{
+      const char* conditions[] = {"", "==", "!=", ">"};
+      uint8_t condition = d.mode & 0x3;
+      string target = (d.mode & 0x8) ? "mem[" + a + " + " + disp + "]" : a + " + " + disp;
+      if(d.mode > 0xB || (d.mode & 0x4)) break;
+      if(condition == 0) return "JMP pc <= " + target;
+      return "JMP if " + b + " " + conditions[condition] + " " + c + " then pc <= " + target;
+    }
+    case 0x4:
+      if(d.mode == 0x0) return "XCHG " + b + " <=> " + c;
+      if(d.mode == 0x1) return "XCHG mem[" + b + " + " + disp + "] <=> " + c;
+      break;
+    case 0x5:{
+      const char* operators[] = {"+", "-", "*", "/"};
+      if(d.mode <= 0x3) return "ARITHMETIC " + a + " <= " + b + " " + operators[d.mode] + " " + c;
+      if(d.mode == 0x4) return "ARITHMETIC " + a + " <= " + b + " + (" + c + (((d.raw >> 16) & 0xF) == 0 ? " << " : " >> ") + disp + ")";
+      break;
+    }
+    case 0x6:{
+      const char* operators[] = {"", "&", "|", "^"};
+      if(d.mode == 0x0) return "LOGIC " + a + " <= ~" + b;
+      if(d.mode <= 0x3) return "LOGIC " + a + " <= " + b + " " + operators[d.mode] + " " + c;
+      break;
+    }
+    case 0x7:
+      if(d.mode == 0x0) return "SHIFT " + a + " <= " + b + " << " + c;
+      if(d.mode == 0x1) return "SHIFT " + a + " <= " + b + " >> " + c;
+      break;
+    case 0x8:
+      if(d.mode == 0x0 || d.mode == 0x3) return "ST mem[" + a + " + " + b + " + " + disp + "] <= " + c;
+      if(d.mode == 0x1) return "PUSH " + a + " += " + disp + "; mem[" + a + "] <= " + c;
+      if(d.mode == 0x2) return "ST mem[mem[" + a + " + " + b + " + " + disp + "]] <= " + c;
+      break;
+    case 0x9:
+      switch(d.mode){
+        case 0x0: return "LD " + a + " <= csr" + std::to_string(d.b);
+        case 0x1: return "LD " + a + " <= " + b + " + " + disp;
+        case 0x2: case 0x8: return "LD " + a + " <= mem[" + b + " + " + c + " + " + disp + "]";
+        case 0x3: return "POP " + a + " <= mem[" + b + "]; " + b + " += " + disp;
+        case 0x4: return "LD csr" + std::to_string(d.a) + " <= " + b;
+        case 0x5: return "LD csr" + std::to_string(d.a) + " <= csr" + std::to_string(d.b) + " | " + disp;
+        case 0x6: return "LD csr" + std::to_string(d.a) + " <= mem[" + b + " + " + c + " + " + disp + "]";
+        case 0x7: return "POP csr" + std::to_string(d.a) + " <= mem[" + b + "]; " + b + " += " + disp;
+      }
+      break;
+  }
+  std::stringstream stream;
+  stream << std::hex << std::setw(8) << std::setfill('0') << d.raw;
+  return "UNKNOWN " + stream.str();
+}
@@ -1,595 +1,452 @@
 #include "../inc/emulator.hpp"
 #include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+Emulator::Emulator(const string& filename, EmulatorOptions o){
+  this->initialize(o);
+  this->input_filename = filename;
+  if(o.restore) this->restore_snapshot();
+  else this->load_image();
+  //the other harts start at the same entry point once it is known
+  for(uint i = 1 ; i < o.harts ; ++i) this->secondary_harts.push_back(new Emulator(this, i));
+  if(this->restored == nullptr) this->reset();
+}
+
+Emulator::Emulator(EmulatorOptions o){
+  this->initialize(o);
+  this->input_filename = "";
+  for(uint i = 1 ; i < o.harts ; ++i) this->secondary_harts.push_back(new Emulator(this, i));
+  this->reset();
+}
 
-Emulator::Emulator(ifstream* i){
-  this->debug = true;    //set to true to generate output file with debug info
-  this->current_address = 0x40000000;
-  this->input_file = i;
+//state and devices of hart 0, nothing is loaded yet
+void Emulator::initialize(EmulatorOptions o){
+  if(o.harts == 0 || o.harts > InterruptRouter::MAX_HARTS) throw ExceptionAlert("Number of harts must be between 1 and " + std::to_string(InterruptRouter::MAX_HARTS) + ".");
+  this->options = o;
+  this->hart_id = 0;
+  this->primary = nullptr;
+  this->stopping = false;
+  this->debug = o.trace == EmulatorOptions::TRACE_TEXT;    //full text trace of every instruction in emulation.txt
+  this->starting_address = BinaryImageFormat::DEFAULT_ENTRY;
+  this->current_address = this->starting_address;
   if(debug)this->output_file = new std::ofstream("emulation.txt");
-  this->emulator_segment_table = new SegmentTable();
-  this->parse_input_hex();
-  //this->print_segments();
-  this->emulate();
-  //this->print_register_status();
+  this->memory = new Memory();
+  this->decode_cache = new DecodeCache(this->memory);
+  this->block_cache = new BlockCache();
+  this->terminal = new Terminal(this->memory, o.detached ? Terminal::DETACHED : o.debug && o.debug_script == "" ? Terminal::OUTPUT_ONLY : Terminal::INTERACTIVE);
+  this->instructions_retired = 0;
+  this->next_event = 0;
+  this->device_event = 0;
+  this->stop_at = NO_LIMIT;
+  this->halted = false;
+  this->semihost = new Semihost(this->memory, this->terminal, &this->next_event, !o.detached);
+  this->code_writes = new CodeWriteQueue(&this->next_event);
+  this->code_writes->add_cache(this->decode_cache);
+  this->code_writes->add_cache(this->block_cache);
+  this->memory->add_code_write_listener(this->code_writes);
+  this->interrupts = new InterruptController(&this->next_event);
+  this->router = new InterruptRouter(this->memory);
+  this->router->add_hart(this->interrupts);
+  this->timer = new Timer(this->memory, o.frequency_mhz, o.realtime, &this->instructions_retired, &this->next_event);
+  this->jit = nullptr;
+  this->trace_writer = nullptr;
+  this->reset_untraced = false;
+  this->restored = nullptr;
+  this->image = nullptr;
+  this->profiler = nullptr;
+  this->recorder = nullptr;
+  this->replayer = nullptr;
+  this->debugger = nullptr;
+  this->snapshot_pending = o.snapshot != EmulatorOptions::SNAPSHOT_NONE;
+  this->skip_idle = o.skip_idle && o.harts == 1;
+  this->idle.armed = false;
+  this->idle.block = nullptr;
+  if(o.trace == EmulatorOptions::TRACE_BINARY) this->trace_writer = new TraceWriter("emulation.trace");
+  if(o.profile) this->profiler = new Profiler();
+  if(o.record_file != "") this->recorder = new EventRecorder(o.record_file);
+  if(o.replay_file != "") this->replayer = new EventReplayer(o.replay_file);
+  if(o.debug) this->debugger = new Debugger(this, &this->next_event, o.debug_script);
+  if(o.core == EmulatorOptions::JIT){
+    this->jit = new JitCompiler();
+    if(!this->jit->is_available()) std::cout << "JIT is not available on this host, blocks are interpreted.\n";
+  }
+}
+
+Emulator::Emulator(Emulator* primary, uint hart_id){
+  this->options = primary->options;
+  this->debug = false;
+  this->hart_id = hart_id;
+  this->primary = primary;
+  this->stopping = false;
+  this->starting_address = primary->starting_address;
+  this->current_address = this->starting_address;
+  this->input_filename = primary->input_filename;
+  this->memory = primary->memory;
+  this->terminal = primary->terminal;
+  this->semihost = primary->semihost;
+  this->timer = primary->timer;
+  this->router = primary->router;
+  this->decode_cache = new DecodeCache(this->memory);
+  this->block_cache = new BlockCache();
+  this->instructions_retired = 0;
+  this->next_event = 0;
+  this->device_event = 0;
+  this->stop_at = NO_LIMIT;
+  this->halted = false;
+  this->code_writes = new CodeWriteQueue(&this->next_event);
+  this->code_writes->add_cache(this->decode_cache);
+  this->code_writes->add_cache(this->block_cache);
+  this->memory->add_code_write_listener(this->code_writes);
+  this->interrupts = new InterruptController(&this->next_event);
+  this->router->add_hart(this->interrupts);
+  this->jit = nullptr;
+  this->trace_writer = nullptr;
+  this->reset_untraced = false;
+  this->restored = nullptr;
+  this->image = nullptr;
+  this->profiler = nullptr;
+  this->recorder = nullptr;
+  this->replayer = nullptr;
+  this->debugger = nullptr;
+  this->snapshot_pending = false;
+  this->skip_idle = false;
+  this->idle.armed = false;
+  this->idle.block = nullptr;
+  if(this->options.core == EmulatorOptions::JIT) this->jit = new JitCompiler();
 }
 
 Emulator::~Emulator(){
-  this->input_file->close();
+  for(size_t i = 0 ; i < this->secondary_harts.size() ; ++i) delete this->secondary_harts[i];
+  delete this->code_writes;
+  delete this->interrupts;
+  delete this->jit;
+  delete this->block_cache;
+  delete this->decode_cache;
+  //everything else belongs to hart 0
+  if(this->primary != nullptr) return;
   if(debug)this->output_file->close();
-  delete this->input_file;
   if(debug)delete this->output_file;
-  delete this->emulator_segment_table;
-}
-
-void Emulator::parse_input_hex(){
-  
-  ulong start_addr = 0;
-
-  bool end = false;
-  string line = "";
-  while(getline(*this->input_file, line) && !end){
-    line = clean_line(line);
-    if(line.size() > 0){
-      Segment* segment1 = new Segment();
-      Segment* segment2 = new Segment();
-      size_t position = line.find("\t");
-      string adr = line.substr(0, position);
-
-      start_addr = this->hex_to_int(adr);
-      segment1->set_start_address(start_addr);
-      segment2->set_start_address(start_addr + 0x4);
-
-      line.erase(0, position + 1);
-
-      //line contains hex values
-      line = clean_line(line);
-
-      for(int column = 0 ; column < 4 ; ++column){
-        size_t position = line.find("\t");
-        string data = line.substr(0, position);
-        line.erase(0,position + 1);
-        line = clean_line(line);
-
-        std::stringstream ss;
-        ss << std::hex << data;
-        unsigned int intValue;
-        ss >> intValue;
-
-        segment1->machine_code.push_back(std::bitset<8>(intValue));
-      }
-
-      for(int column = 0 ; column < 4 ; ++column){
-        size_t position = line.find("\t");
-        string data = line.substr(0, position);
-        line.erase(0,position + 1);
-        line = clean_line(line);
-
-        std::stringstream ss;
-        ss << std::hex << data;
-        unsigned int intValue;
-        ss >> intValue;
-
-        segment2->machine_code.push_back(std::bitset<8>(intValue));
-      }
-      this->emulator_segment_table->add_segment(segment1);
-      this->emulator_segment_table->add_segment(segment2);
-      
-    }
+  delete this->trace_writer;
+  for(size_t i = 0 ; i < this->devices.size() ; ++i) delete this->devices[i];
+  delete this->semihost;
+  delete this->terminal;
+  delete this->timer;
+  delete this->router;
+  delete this->memory;
+  delete this->restored;
+  delete this->image;
+  delete this->profiler;
+  delete this->recorder;
+  delete this->replayer;
+  delete this->debugger;
+}
+
+//binary images are mapped, anything else is parsed as hex
+void Emulator::load_image(){
+  if(this->options.shared_image != nullptr){
+    this->image = new MappedImage(this->options.shared_image->get_descriptor(), this->input_filename);
+    this->image->map_into(this->memory);
+    this->starting_address = this->options.shared_image->get_entry();
+  }
+  else this->load_file(this->input_filename);
+  for(size_t i = 0 ; i < this->options.memory_overrides.size() ; ++i){
+    this->memory->write_word(this->options.memory_overrides[i].first, this->options.memory_overrides[i].second);
   }
 }
 
-void Emulator::emulate(){
-  bool start = false;
-  int i = 0 ;
-  for( ; i < this->emulator_segment_table->segments.size(); ++i){
-    //emulation can start
-    if(this->emulator_segment_table->segments.at(i)->get_start_address() == this->starting_address) {
-      start = true;
-      break;
-    }
+void Emulator::load_file(const string& filename){
+  const string extension = ".bin";
+  if(filename.size() >= extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0){
+    if(this->image != nullptr) throw ExceptionAlert("Only one binary image can be mapped, " + filename + " is the second one.");
+    this->image = new MappedImage(filename);
+    this->image->map_into(this->memory);
+    this->starting_address = this->image->get_entry();
   }
+  else HexLoader::load(filename, this->memory);
+}
 
-  if(!start) throw new ExceptionAlert("No segment can currently execute.");
-
-  this->registers[15] = this->starting_address; //program counter points to the next instruction
-  this->current_address = this->starting_address;  //instruction currently executing
-
-  //special instructions insert a new segment into memory as part of literal pool
-  //these instructions are made of two parts, so the PC is incremented twice
-  bool last_instruction_jump = false;
-  i = 0;
-
-  while(start){
-
-    this->current_address = this->registers[0xF];
-    this->registers[0xF] += 0x4; 
-    Segment* current_segment = this->get_segment_by_address(this->current_address);
-
-    last_instruction_jump = false;
-
-    //I - 7654
-    string I4_string = current_segment->machine_code.at(0).to_string().substr(0,4);
-    bitset<4> I4_bits = bitset<4>(I4_string);
-    ulong I4_number = I4_bits.to_ullong();
-
-    //I - 3210
-    string I0_string = current_segment->machine_code.at(0).to_string().substr(4);
-    bitset<4> I0_bits = bitset<4>(I0_string);
-    ulong I0_number = I0_bits.to_ullong();
-
-    //II - 7654
-    string II4_string = current_segment->machine_code.at(1).to_string().substr(0,4);
-    bitset<4> II4_bits = bitset<4>(II4_string);
-    ulong II4_number = II4_bits.to_ullong();
-
-    //II - 3210
-    string II0_string = current_segment->machine_code.at(1).to_string().substr(4);
-    bitset<4> II0_bits = bitset<4>(II0_string);
-    ulong II0_number = II0_bits.to_ullong();
-
-    //III - 7654
-    string III4_string = current_segment->machine_code.at(2).to_string().substr(0,4);
-    bitset<4> III4_bits = bitset<4>(III4_string);
-    ulong III4_number = III4_bits.to_ullong();
-
-    //III - 3210
-    string III0_string = current_segment->machine_code.at(2).to_string().substr(4);
-    bitset<4> III0_bits = bitset<4>(III0_string);
-    ulong III0_number = III0_bits.to_ullong();
-
-    //IV - 7654
-    string IV4_string = current_segment->machine_code.at(3).to_string().substr(0,4);
-    bitset<4> IV4_bits = bitset<4>(IV4_string);
-    ulong IV4_number = IV4_bits.to_ullong();
-
-    //IV - 3210
-    string IV0_string = current_segment->machine_code.at(3).to_string().substr(4);
-    bitset<4> IV0_bits = bitset<4>(IV0_string);
-    ulong IV0_number = IV0_bits.to_ullong();
-
-    bitset<12> D_bits = bitset<12>(III0_string + IV4_string + IV0_string);
-
-    bool D_is_negative = D_bits[11];
-
-    ulong M = I0_number;
-    ulong A = II4_number;
-    ulong B = II0_number;
-    ulong C = III4_number;    
-    ulong D_signed = D_bits.to_ullong();
-    int D = 0;
-
-    if (D_is_negative) {
-      // Apply sign extension by setting bits 12-63 to 1 (for a 64-bit signed value)
-      for(int k = 0 ; k < 12 ; ++k){
-        if(D_bits[k]) D_bits.reset(k);
-        else D_bits.set(k);
-      }
-      D = D_bits.to_ullong() + 1;
-      D *= -1;
-    } else {
-        D = static_cast<int>(D_signed);
-    }
+void Emulator::load_hex(const string& text){
+  HexLoader::load_text(text.data(), text.size(), this->memory);
+}
 
+//emulation can start only if something was loaded at the starting address
+void Emulator::check_entry() const {
+  if(this->restored == nullptr && !this->memory->is_mapped(this->starting_address)) throw ExceptionAlert("Nothing is loaded at the starting address.");
+}
 
-    if(debug){
-      *this->output_file<<"\n" << std::to_string(i) << "\t"; 
-      this->print_register_temp();
-    }
+//runs the image to the halt from reset, repeat times, and prints the result unless detached
+void Emulator::run(){
+  this->check_entry();
+  if(this->restored != nullptr && this->options.repeat != 1) throw ExceptionAlert("A restored snapshot can be run only once.");
 
-    switch (I4_number)
-    {
-    case 0x0: //HALT
-    {
-      start = false;
-      this->print_register_status();
-      return;
-      break;
-    }
-    case 0x1: //INT
-    {
-      if(debug)*this->output_file << "INT" << "\n";
-      this->push_status();
-      this->push_pc();
-      this->status_registers[2] = 4;
-      this->status_registers[0] &= (~0x4);
-      this->registers[0xF] = this->status_registers[1];
-      last_instruction_jump = true;
-      break;
-    }
-    case 0x2: //CALL
-    {
-      if(debug)*this->output_file << "CALL ";
-      switch (M)
-      {
-      case 0x0:{
-        if(debug)*this->output_file << "pc <= gpr" << std::to_string(A)<< " + gpr"<< std::to_string(B) <<" + " << std::to_string(D) << "\n";
-        this->push_pc();
-        this->registers[0xF] = this->registers[A] + this->registers[B] + D;
-        break;
-      }
-      case 0x1:{
-        if(debug)*this->output_file << "pc <= mem[gpr" << std::to_string(A)<< " + gpr"<< std::to_string(B) <<" + " << std::to_string(D) << "]\n";
-        this->push_pc_special();
-        Segment* that_segment = this->get_segment_by_address(this->registers[A] + this->registers[B] + D);
-        this->registers[0xF] = this->get_segment_value(that_segment);
-        break;
-      }
-      
-      default:
-        throw ExceptionAlert("Unknown operation code.");
-        break;
-      }
-      last_instruction_jump = true;
-      break;
-    }
-    case 0x3: //JMP
-    {
-      if(debug)*this->output_file << "JMP ";
-      switch (M)
-      {
-      case 0x0:{
-        if(debug)*this->output_file << "pc = reg" << std::to_string(A) << " + " << std::to_string(D) << "\n";
-        this->registers[15] = this->registers[A] + D;
-        last_instruction_jump = true;
-        break;
-      }
-      case 0x1:{
-        if(debug)*this->output_file << "if reg"<<std::to_string(B)<< "== reg"<<std::to_string(C) << "then pc = reg" << std::to_string(A) << " + " << std::to_string(D) ;
-        if(this->registers[B] == this->registers[C]) {*this->output_file << "CLEAR\n";this->registers[15] <= this->registers[A] + D; last_instruction_jump = true;}
-        break;
-      }
-      case 0x2:{
-        if(debug)*this->output_file << "if reg"<<std::to_string(B)<< "!= reg"<<std::to_string(C) << "then pc = reg" << std::to_string(A) << " + " << std::to_string(D) << "\n";
-        if(this->registers[B] != this->registers[C]) {*this->output_file << "CLEAR\n";this->registers[15] <= this->registers[A] + D; last_instruction_jump = true;}
-        break;
-      }
-      case 0x3:{
-        if(debug)*this->output_file << "if reg"<<std::to_string(B)<< "> reg"<<std::to_string(C) << "then pc = reg" << std::to_string(A) << " + " << std::to_string(D) << "\n";
-        if(static_cast<uint32_t>(this->registers[B]) > static_cast<uint32_t>(this->registers[C])) {*this->output_file << "CLEAR\n";this->registers[15] <= this->registers[A] + D;last_instruction_jump = true;}
-        break;
-      }
-      case 0x8:{
-        last_instruction_jump = true;
-        Segment* that_segment = this->get_segment_by_address(this->registers[A] + D);
-
-        uint32_t segment_value = this->get_segment_value(that_segment);
-        if(debug)*this->output_file << "pc = mem[" << std::to_string(A) << " + " << std::to_string(D) << "]\n";
-        this->registers[15] = segment_value;
-        break;
-      }
-      case 0x9:{
-        if(debug)*this->output_file << "if reg"<<std::to_string(B)<< "== reg"<<std::to_string(C) << "then pc = mem[reg" << std::to_string(A) << " + " << std::to_string(D) << "]";
-        if(this->registers[B] == this->registers[C]) {
-          
-          Segment* that_segment = this->get_segment_by_address(this->registers[A] + D);
-          uint32_t segment_value = this->get_segment_value(that_segment);
-          this->registers[15] = segment_value;
-          last_instruction_jump = true; //pc is updated by instruction
-        }
-        break;
-      }
-      case 0xA:{
-        if(debug)*this->output_file << "if reg"<<std::to_string(B)<< "!= reg"<<std::to_string(C) << "then pc = mem[reg" << std::to_string(A) << " + " << std::to_string(D) << "]";
-        if(this->registers[B] != this->registers[C]) {
-          
-          Segment* that_segment = this->get_segment_by_address(this->registers[A] + D);
-          uint32_t segment_value = this->get_segment_value(that_segment);
-          this->registers[15] = segment_value;
-          last_instruction_jump = true; //pc is updated by instruction
-        }
-        break;
-      }
-      case 0xB:{
-        if(debug)*this->output_file << "if reg"<<std::to_string(B)<< "> reg"<<std::to_string(C) << "then pc = mem[reg" << std::to_string(A) << " + " << std::to_string(D) << "]";
-        if(this->registers[B] != this->registers[C]) {
-          
-          Segment* that_segment = this->get_segment_by_address(this->registers[A] + D);
-          uint32_t segment_value = this->get_segment_value(that_segment);
-          this->registers[15] = segment_value;
-          last_instruction_jump = true; //pc is updated by instruction
-        }
-        break;
-      }
-      default:
-        //throw new ExceptionAlert("No such JMP operation exists.");
-        throw ExceptionAlert("Unknown operation code.");
-        break;
-      }
-      break;
-    }
-    case 0x4: //gpr1 <=> gpr2
-    {
-      if(debug)*this->output_file << "SWITCH reg" <<std::to_string(B)<< "and"<<std::to_string(C)<<"\n";
-      ulong temp = this->registers[B]; 
-      this->registers[B] = this->registers[C];
-      this->registers[C] = temp;
-      break;
-    }
-    case 0x5: //addition, subtraction, multiplication, division
-    {
-      if(debug)*this->output_file << "ARITHMETIC";
-      switch (M)
-      {
-      case 0x0:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<"+r" <<std::to_string(C)<<"\n";
-        this->registers[A] = this->registers[B] + this->registers[C];
-        break;
-      }
-      case 0x1:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<"-r" <<std::to_string(C)<<"\n";
-        this->registers[A] = this->registers[B] - this->registers[C];
-        break;
-      }
-      case 0x2:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<"*r" <<std::to_string(C)<<"\n";
-        this->registers[A] = this->registers[B] * this->registers[C];
-        break;
-      }
-      case 0x3:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<"/r" <<std::to_string(C)<<"\n";
-        this->registers[A] = this->registers[B] / this->registers[C];
-        break;
-      }
-      case 0x4:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<"/r" <<std::to_string(C)<<"\n";
-        
-        if(III0_number == 0)
-        {
-          this->registers[A] = this->registers[B] + (this->registers[C] << D);
-        }
-        else
-        {
-          this->registers[A] = this->registers[B] + (this->registers[C] >> D);
-        }
-        break;
-      }
-      default:
-        //throw new ExceptionAlert("No such Arithmetic operation exists.");
-        std::string exact_error = "Unknown operation code: " + I4_string + " "+ I0_string +" - " + II4_string + " "+ II0_string +" - "+ III4_string +" " + III0_string +" - "+ IV0_string + " " + IV4_string;
-
-        throw ExceptionAlert(exact_error);
-        break;
-      }
-      break;
-    }
-    case 0x6: //not, and, or, nor 
-    {
-      if(debug)*this->output_file << "LOGIC ";
-      switch (M)
-      {
-      case 0x0:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = ~"  <<"r" <<std::to_string(B) << "\n";
-        this->registers[A] = ~this->registers[B];
-        break;
-      }
-      case 0x1:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<"&r" <<std::to_string(C)<<"\n";
-        this->registers[A] = this->registers[B] & this->registers[C];
-        break;
-      }
-      case 0x2:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<"|r" <<std::to_string(C)<<"\n";
-        this->registers[A] = this->registers[B] | this->registers[C];
-        break;
-      }
-      case 0x3:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<"^r" <<std::to_string(C)<<"\n";
-        this->registers[A] = this->registers[B] ^ this->registers[C];
-        break;
-      }
-      default:
-        //throw new ExceptionAlert("No such Logical operation exists.");
-        throw ExceptionAlert("Unknown operation code.");
-        break;
-      }
-      break;
-    }
-    case 0x7: //shift left, shift right
-    {
-      if(debug)*this->output_file << "SHIFT ";
-      switch (M)
-      {
-      case 0x0:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<"<<r" <<std::to_string(C)<<"\n";
-        this->registers[A] = this->registers[B] << this->registers[C];
-        break;
-      }
-      case 0x1:{
-        if(debug)*this->output_file <<"r" <<std::to_string(A) << " = "  <<"r" <<std::to_string(B)<<">>r" <<std::to_string(C)<<"\n";
-        this->registers[A] = this->registers[B] >> this->registers[C];
-        break;
-      }
-      default:
-        //throw new ExceptionAlert("No such Shift operation exists.");
-        throw ExceptionAlert("Unknown operation code.");
-        break;
-      }
-      break;
-    }
-    case 0x8: //st, push
-    {
-      if(debug)*this->output_file << "ST or PUSH\t";
-      switch (M)
-      {
-      case 0x0:{
-        if(debug)*this->output_file << "ST mem[gpr"<<std::to_string(A)<<" + gpr" <<std::to_string(B)<<" + " << std::to_string(D) << "] r" << std::to_string(C)<< "\n";
-        Segment* that_segment = this->get_segment_by_address(this->registers[B] + this->registers[A] + D);
-        
-        string segment_value = this->number_to_binary32_string(this->registers[C]);
-        that_segment->set_machine_code_by_stringvalue(segment_value);
-
-        break;
-      }
-      case 0x1:{
-        if(debug)*this->output_file << "PUSH r" <<std::to_string(C) << "\n"; 
-        this->registers[A] += D;
-        Segment* that_segment = this->get_segment_by_address(this->registers[A]);
-        string symbol_value = this->number_to_binary32_string(this->registers[C]);
-        that_segment->set_machine_code_by_stringvalue(symbol_value);
-        break;
-      }
-      case 0x2:{
-        
-        if(debug)*this->output_file << "ST mem[mem[gpr"<<std::to_string(A)<<" + gpr" <<std::to_string(B)<<" + " << std::to_string(D) << "]] r" << std::to_string(C);
-        Segment* that_segment = this->get_segment_by_address(this->registers[B] + this->registers[A] + D);
-        if(debug)*this->output_file << "with value " << std::to_string(this->get_segment_value(that_segment));
-        that_segment = this->get_segment_by_address(this->get_segment_value(that_segment));
-        string segment_value = this->number_to_binary32_string(this->registers[C]);
-        //WATCH
-        that_segment->set_machine_code_by_stringvalue(segment_value);
-        if(debug)*this->output_file << " so the final mem value is " << std::to_string(this->get_segment_value(that_segment)) << "\n";
-
-        break;
-      }
-      case 0x3:
-      {
-        if(debug)*this->output_file << "ST mem[gpr"<<std::to_string(A)<<" + gpr" <<std::to_string(B)<<" + " << std::to_string(D) << "] r" << std::to_string(C)<< "\n";
-        Segment* that_segment = this->get_segment_by_address(this->registers[B] + this->registers[A] + D);
-        
-        string segment_value = this->number_to_binary32_string(this->registers[C]);
-        that_segment->set_machine_code_by_stringvalue(segment_value);
-
-        break;
-      }
-      
-      default:
-        throw ExceptionAlert("Unknown operation code.");
-        break;
-      }
-      break;
-    }
-    case 0x9: //ld, pop
-    {
-      if(debug)*this->output_file << "LD ";
-      switch (M)
-      {
-      case 0x0:{
-        if(debug)*this->output_file << "csr"<<std::to_string(B)<< " r" << std::to_string(A)<< "\n";
-        this->registers[A] = this->status_registers[B];
-        break;
-      }
-      case 0x1:{
-        if(debug)*this->output_file << "gpr "<<std::to_string(B)<<" + " << std::to_string(D) << " r" << std::to_string(A)<< "\n";
-        this->registers[A] = this->registers[B] + D;
-        break;
-      }
-      case 0x2:{
-        if(debug)*this->output_file << "[gpr "<<std::to_string(B)<<" + " << std::to_string(D) << "] r" << std::to_string(A)<< "\n";
-        Segment* that_segment = this->get_segment_by_address(this->registers[B] + this->registers[C] + D);
-        
-        uint32_t segment_value = this->get_segment_value(that_segment);
-        this->registers[A] = segment_value;
-       
-        break;
-      }
-      case 0x3:{
-        if(debug)*this->output_file << "actually POP "<<std::to_string(A) << "\n";
-        Segment* that_segment = this->get_segment_by_address(this->registers[B]);
-        uint32_t segment_value = this->get_segment_value(that_segment);
-
-        this->registers[A] = segment_value;
-        this->registers[B] += D;
-
-        //if next instruction is POP status, then we have IRET and it must be done atomically
-        Segment* helper_segment = this->get_segment_by_address(this->current_address + 0x4);
-        uint32_t helper_value = this->get_segment_value(helper_segment);
-        string result_address = "";
-        for(int h = 0 ; h < 4 ; ++h){
-          result_address+=helper_segment->machine_code.at(h).to_string();
-        }
-        bitset<32> binary_value(result_address);
-        helper_value =  binary_value.to_ullong();
-        if(helper_value == 0x970E0004){
-          if(debug)*this->output_file << "+ POP STATUS = IRET\n";
-          Segment* next_segment = this->get_segment_by_address(this->registers[0xE]);
-          uint32_t new_segment_value = this->get_segment_value(next_segment);
-          this->status_registers[0] = new_segment_value;
-          this->registers[0xE] += 4;
-        }
-
-        break;
-      }
-      case 0x4:{
-        if(debug)*this->output_file << "r"<<std::to_string(B)<< " csr" << std::to_string(A)<< "\n";
-        this->status_registers[A] = this->registers[B];
-        break;
-      }
-      case 0x5:{
-        this->status_registers[A] = this->status_registers[B] | D;
-        break;
-      }
-      case 0x6:{
-        Segment* that_segment = this->get_segment_by_address(this->registers[B] + this->registers[C] + D);
-
-        uint32_t segment_value = this->get_segment_value(that_segment);
-
-        this->status_registers[A] = segment_value;
-        break;
-      }
-      case 0x7:{
-        Segment* that_segment = this->get_segment_by_address(this->registers[B]);
-        this->registers[B] += D;
-
-        uint32_t segment_value = this->get_segment_value(that_segment);
-
-        this->status_registers[A] = segment_value;
-        break;
-      }
-
-      case 0x8:
-      {
-        Segment* that_segment = this->get_segment_by_address(this->registers[B] + this->registers[C] + D);
-        
-        uint32_t segment_value = this->get_segment_value(that_segment);
-        this->registers[A] = segment_value;
-        break;
-      }
-      
-      default:
-        throw ExceptionAlert("Unknown operation code.");
-        break;
-      }
-      break;
-    }
-      
-    
-    default:
-      throw ExceptionAlert("Unknown operation code.");
-      break;
-    }
+  uint64_t first_instruction = this->instructions_retired;
+  for(size_t i = 0 ; i < this->secondary_harts.size() ; ++i) first_instruction += this->secondary_harts[i]->instructions_retired;
+  auto start_time = std::chrono::steady_clock::now();
 
-    ++i;
+  for(uint run = 0 ; run < this->options.repeat ; ++run){
+    //a restored snapshot continues where it was taken
+    if(this->restored == nullptr) this->reset();
+    if(this->debugger != nullptr && run == 0) this->debugger->request_stop("at the entry point");
+    this->run_harts();
+  }
 
+  auto end_time = std::chrono::steady_clock::now();
+  if(this->options.detached) return;
+  this->terminal->flush();
+  if(this->snapshot_pending) std::cout << "Snapshot point was not reached, " << this->options.snapshot_file << " was not written.\n";
+  if(this->replayer != nullptr && (this->replayer->get_remaining() != 0 || this->replayer->get_late() != 0)){
+    std::cout << "Replay diverged from the recorded run, " << this->replayer->get_late() << " events were delivered late and "
+              << this->replayer->get_remaining() << " were never delivered.\n";
+  }
+  this->print_register_status();
+  if(this->profiler != nullptr) this->write_profile();
+
+  if(this->options.measure){
+    double seconds = std::chrono::duration<double>(end_time - start_time).count();
+    uint64_t executed = this->instructions_retired - first_instruction;
+    for(size_t i = 0 ; i < this->secondary_harts.size() ; ++i) executed += this->secondary_harts[i]->instructions_retired;
+    double mips = seconds > 0 ? executed / seconds / 1e6 : 0;
+    const char* core_names[] = {"threaded", "block", "jit"};
+    std::cout << "\n" << core_names[this->options.core] << " core executed "
+              << executed << " instructions in " << std::fixed << std::setprecision(3)
+              << seconds * 1000 << " ms, " << std::setprecision(2) << mips << " MIPS\n";
   }
 }
 
-void Emulator::print_segments(){
-  printf("SEGMENT TABLE\n");
-  *this->output_file << "\nSEGMENT TABLE\n";
-  for(int i = 0 ; i < this->emulator_segment_table->segments.size(); ++i){
-    
-    *this->output_file << std::to_string(i) << "\t";
-
-    std::stringstream stream;
-    stream << std::hex << this->emulator_segment_table->segments.at(i)->get_start_address();
-    std::string hexString = stream.str();
-    *this->output_file << hexString << "\t";
+//runs hart 0 for n more instructions, or fewer if it halts or exits first
+//the cores look at the count where they look at next_event, so a block core finishes the block it is in
+//reaching the count is not a service point: the devices are next serviced where they would have been without it,
+//so the guest sees the same run however it is split
+uint64_t Emulator::run_for(uint64_t n){
+  if(!this->secondary_harts.empty()) throw ExceptionAlert("Only an emulator with one hart can be run for a number of instructions.");
+  if(this->is_finished()) return 0;
+  uint64_t first_instruction = this->instructions_retired;
+  this->stop_at = n > NO_LIMIT - first_instruction ? NO_LIMIT : first_instruction + n;
+  this->set_next_event(std::min(this->get_next_event(), this->stop_at));
+  this->timer->set_owner(std::this_thread::get_id());
+  try{
+    this->run_core();
+  }
+  catch(...){
+    this->end_run_for();
+    throw;
+  }
+  this->end_run_for();
+  return this->instructions_retired - first_instruction;
+}
 
+//next_event still at the limit goes back to the devices' deadline, one pulled in meanwhile is kept
+void Emulator::end_run_for(){
+  uint64_t limit = this->stop_at;
+  __atomic_compare_exchange_n(&this->next_event, &limit, this->device_event, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  this->stop_at = NO_LIMIT;
+}
 
-    for(int j = 0 ; j < this->emulator_segment_table->segments.at(i)->machine_code.size() ; ++j){
-      *this->output_file << this->emulator_segment_table->segments.at(i)->machine_code.at(j).to_string() << " ";
+//devices are serviced first when they are due, so an interrupt may be taken before the instruction
+bool Emulator::step(){
+  if(!this->secondary_harts.empty()) throw ExceptionAlert("Only an emulator with one hart can be stepped.");
+  if(this->is_finished()) return false;
+  this->running = true;
+  this->trace_reset();
+  if(this->instructions_retired >= this->get_next_event()){
+    this->service_devices();
+    if(this->is_finished()) return false;
+  }
+  this->step_instruction();
+  return true;
+}
 
+//the guest came back to the same registers and status without storing anything or taking an interrupt,
+//so its memory is unchanged as well and it would go around the same loop until an interrupt comes
+//loops that count or poll the instruction counters change a register and are not found
+//the probe stops before anything that would be seen later: an instruction that stores, writes a csr or traps,
+//and a due event, since it is not where the cores would service it
+bool Emulator::is_waiting(uint32_t max_steps){
+  CpuContext start = this->context;
+  uint64_t start_instructions = this->instructions_retired;
+  uint32_t start_address = this->current_address;
+  bool waiting = false;
+  try{
+    for(uint32_t i = 0 ; i < max_steps && !waiting ; ++i){
+      if(this->instructions_retired >= this->get_next_event()) break;
+      if(!may_idle(this->decode_cache->fetch(this->context.registers[0xF]))) break;
+      this->step_instruction();
+      waiting = memcmp(this->context.registers, start.registers, sizeof(start.registers)) == 0
+                && memcmp(this->context.status_registers, start.status_registers, sizeof(start.status_registers)) == 0;
     }
-    *this->output_file << "\n";
+  }
+  catch(ExceptionAlert&){
+    //left for the run to fail on
+    waiting = false;
+  }
+  this->context = start;
+  this->instructions_retired = start_instructions;
+  this->current_address = start_address;
+  return waiting;
+}
+
+void Emulator::add_device(uint32_t base, uint32_t size, CallbackDevice::Callback written){
+  this->devices.push_back(new CallbackDevice(this->memory, base, size, written));
+}
+
+void Emulator::raise_interrupt(uint32_t cause){
+  std::lock_guard<std::recursive_mutex> guard(this->memory->get_device_lock());
+  this->router->raise(cause);
+}
+
+//runs this hart until it halts
+void Emulator::run_core(){
+  this->trace_reset();
+  this->code_writes->set_owner(std::this_thread::get_id());
+  this->code_writes->deliver();
+  //memory may have been written from outside since the previous run
+  this->idle.armed = true;
+  this->idle.block = nullptr;
+
+  //tracing is a compile time policy, cores built with NoTrace contain no tracing code at all
+  if(this->options.core == EmulatorOptions::THREADED){
+    if(this->options.trace == EmulatorOptions::TRACE_TEXT) this->emulate_threaded<TextTrace>();
+    else if(this->options.trace == EmulatorOptions::TRACE_BINARY) this->emulate_threaded<BinaryTrace>();
+    else if(this->options.profile) this->emulate_threaded<ProfileTrace>();
+    else if(this->debugger != nullptr) this->emulate_threaded<DebugTrace>();
+    else this->emulate_threaded<NoTrace>();
+  }
+  else{
+    if(this->options.trace == EmulatorOptions::TRACE_TEXT) this->emulate_blocks<TextTrace>();
+    else if(this->options.trace == EmulatorOptions::TRACE_BINARY) this->emulate_blocks<BinaryTrace>();
+    else if(this->options.profile) this->emulate_blocks<ProfileTrace>();
+    else if(this->debugger != nullptr) this->emulate_blocks<DebugTrace>();
+    else this->emulate_blocks<NoTrace>();
+  }
+}
+
+//hart 0 runs on the calling thread and every other hart on a thread of its own, the run ends once all of them halted
+//a failing hart stops the others at their next event, the first failure is reported
+void Emulator::run_harts(){
+  this->stopping = false;
+  //the other harts may write tim_cfg as soon as they start
+  this->timer->set_owner(std::this_thread::get_id());
+  vector<std::thread> threads;
+  for(size_t i = 0 ; i < this->secondary_harts.size() ; ++i){
+    this->secondary_harts[i]->failure = "";
+    threads.emplace_back(&Emulator::run_secondary, this->secondary_harts[i]);
+  }
+  try{
+    this->run_core();
+  }
+  catch(...){
+    this->stopping = true;
+    for(size_t i = 0 ; i < threads.size() ; ++i) threads[i].join();
+    throw;
+  }
+  for(size_t i = 0 ; i < threads.size() ; ++i) threads[i].join();
+  for(size_t i = 0 ; i < this->secondary_harts.size() ; ++i){
+    if(!this->secondary_harts[i]->failure.empty()) throw ExceptionAlert("Hart " + std::to_string(i + 1) + ": " + this->secondary_harts[i]->failure);
   }
 }
 
+void Emulator::run_secondary(){
+  try{
+    this->run_core();
+  }
+  catch(ExceptionAlert& e){
+    this->failure = e.get_message();
+    this->primary->stopping = true;
+  }
+  catch(...){
+    this->failure = "Emulation failed.";
+    this->primary->stopping = true;
+  }
+}
+
+//hot spot report of --profile, symbolized when the linker's symbol map is found
+void Emulator::write_profile(){
+  string symbol_file = this->options.symbol_file;
+  bool explicit_map = !symbol_file.empty();
+  if(!explicit_map){
+    size_t dot = this->input_filename.find_last_of('.');
+    symbol_file = this->input_filename.substr(0, dot) + ".map";
+  }
+  SymbolMap* symbols = nullptr;
+  if(explicit_map || ifstream(symbol_file).good()) symbols = new SymbolMap(symbol_file);
+  else std::cout << "No symbol map " << symbol_file << ", the profile lists addresses only.\n";
+
+  ofstream out(this->options.profile_file);
+  this->profiler->report(out, symbols, this->memory);
+  delete symbols;
+  std::cout << "Profile written to " << this->options.profile_file << ".\n";
+}
+
+//processor state after reset, memory keeps what was loaded or written by the previous run
+void Emulator::reset(){
+  for(int i = 0 ; i < 16 ; ++i) this->context.registers[i] = 0;
+  for(uint32_t i = 0 ; i < CpuContext::WRITABLE_CSRS ; ++i) this->context.status_registers[i] = 0;
+  for(int i = 0 ; i < CpuContext::EVENT_COUNT ; ++i) this->context.events[i] = 0;
+  this->context.status_registers[CpuContext::CSR_HARTID] = this->hart_id;
+  this->halted = false;
+  //secondary harts follow an entry point that was set after they were created
+  if(this->primary != nullptr) this->starting_address = this->primary->starting_address;
+  this->context.registers[15] = this->starting_address; //program counter points to the next instruction
+  for(size_t i = 0 ; i < this->options.register_overrides.size() ; ++i){
+    this->context.registers[this->options.register_overrides[i].first] = this->options.register_overrides[i].second;
+  }
+  this->current_address = this->context.registers[15];  //instruction currently executing
+
+  //the constructor resets and run resets again, only the reset a run starts from is traced
+  this->reset_untraced = true;
+  this->interrupts->reset();
+  //devices are reset once, by hart 0
+  if(this->primary == nullptr){
+    this->router->reset();
+    this->timer->reset();
+    this->semihost->reset();
+    for(size_t i = 0 ; i < this->secondary_harts.size() ; ++i) this->secondary_harts[i]->reset();
+  }
+  this->schedule_next_event();
+}
+
+void Emulator::restore_snapshot(){
+  this->restored = new Snapshot(this->input_filename);
+  const SnapshotHeader& header = this->restored->get_header();
+  this->restored->map_into(this->memory);
+  this->context = header.context;
+  this->current_address = this->context.registers[0xF];
+  this->instructions_retired = header.instructions_retired;
+  this->device_event = this->instructions_retired;
+  this->set_next_event(this->instructions_retired);
+  this->timer->restore(header.timer_remaining);
+  this->interrupts->set_pending(header.pending_interrupts);
+}
+
+void Emulator::take_snapshot(){
+  SnapshotHeader header = {};
+  header.instructions_retired = this->instructions_retired;
+  header.timer_remaining = this->timer->get_deadline() - this->instructions_retired;
+  header.pending_interrupts = this->interrupts->get_pending();
+  header.context = this->context;
+  Snapshot::save(this->options.snapshot_file, header, this->memory);
+  this->snapshot_pending = false;
+}
+
 void Emulator::print_register_status(){
+  if(this->semihost->has_exited()) std::cout << "Emulated program exited with code " << this->semihost->get_exit_code() << ".\n";
+  else std::cout << "Emulated processor executed halt instruction.\n";
+  std::cout << "Emulated processor state\n";
+  if(!this->secondary_harts.empty()) std::cout << "hart 0\n";
+  this->print_registers();
+  for(size_t i = 0 ; i < this->secondary_harts.size() ; ++i){
+    std::cout << "\nhart " << std::to_string(i + 1) << "\n";
+    this->secondary_harts[i]->print_registers();
+  }
+}
+
+void Emulator::print_registers(){
   int hexWidth = 8;
-  std::cout << "Emulated processor executed halt instruction.\n" << "Emulated processor state\n";
   for(int i = 0 ; i < 16; ++i){
     std::stringstream stream;
-    stream << std::hex << std::setw(hexWidth) << std::setfill('0')  << this->registers[i];
+    stream << std::hex << std::setw(hexWidth) << std::setfill('0')  << this->context.registers[i];
     string hexString = stream.str();
     std::cout<<"r"<<std::to_string(i) <<"=0x" << hexString << "\t";
     if (i >= 3 && (i - 3) % 4 == 0) std::cout << "\n";
@@ -606,140 +463,180 @@ void Emulator::print_register_temp(){
 
   for(int i = 0 ; i < 16; ++i){
     std::stringstream stream;
-    stream << std::hex << std::setw(hexWidth) << std::setfill('0')  << this->registers[i];
+    stream << std::hex << std::setw(hexWidth) << std::setfill('0')  << this->context.registers[i];
     string hexString = stream.str();
     *this->output_file<<"r"<<std::to_string(i) <<"=0x" << hexString << "\n";
   }
   for(int i = 0 ; i < 3; ++i){
     std::stringstream stream;
-    stream << std::hex << std::setw(hexWidth) << std::setfill('0')  << this->status_registers[i];
+    stream << std::hex << std::setw(hexWidth) << std::setfill('0')  << this->context.status_registers[i];
     string hexString = stream.str();
     *this->output_file<<"c"<<std::to_string(i) <<"=0x" << hexString << "\n";
   }
   *this->output_file << "\n";
 }
 
-Segment* Emulator::get_segment_by_address(ulong a){
-  for(int i = 0 ; i < this->emulator_segment_table->segments.size(); ++i)
-  {
-    if(this->emulator_segment_table->segments.at(i)->get_start_address() == a) return this->emulator_segment_table->segments.at(i);
-  }
-  //make a NEW SEGMENT;
-
-  std::stringstream stream;
-  stream << std::hex << a;
-  string hexString = stream.str();
-
-  if(debug) std::cout << "No segment, allocate a new one at address 0x" << hexString << "\n";
-
-  Segment* new_segment = new Segment();
-  new_segment->set_start_address(a);
-  for(int j = 0; j < 4; ++j){
-    bitset<8> bitChunk("00000000");
-    new_segment->machine_code.push_back(bitChunk);
-  }
-  this->emulator_segment_table->add_segment(new_segment);
-  return new_segment;
-}
-
-//removes starting blanco spaces
-string Emulator::clean_line(string l){
-  string new_line = "";
-  uint i = 0;
-  //ignore all white spaces
-  while(l[i] == ' ' || l[i] == '\t') ++i;
-  //stop until EOT is reached
-  while(l[i] != '#' && l[i] != '\0'){
-    new_line += l[i++];
-  }
-  return new_line;
-}
-
-uint Emulator::hex_to_int(string s){
-
-  unsigned long decimalValue = std::stoul(s, nullptr, 0); // Convert hexadecimal string to decimal value
-  uint32_t uintValue = static_cast<uint32_t>(decimalValue); // Convert the decimal value to a uint32_t
-
-  return uintValue;
-}
-
 uint Emulator::string_to_int(string s){
   try {
         return stoi(s);
     } catch (const std::invalid_argument& e) {
-        throw new ExceptionAlert("Invalid argument for string to int method.");
+        throw ExceptionAlert("Invalid argument for string to int method.");
         return -1;
     } catch (const std::out_of_range& e) {
-        throw new ExceptionAlert("Argument out of range for string to int method.");
+        throw ExceptionAlert("Argument out of range for string to int method.");
         return -1;
     }
 }
 
-string Emulator::stringify_segment(Segment* s){
-  string result_address = "";
-  for(int j = 0 ; j < 4 ; ++j){
-    string that_chunk = s->machine_code.at(j).to_string();
-    result_address+=s->machine_code.at(j).to_string();
-  }
-  return result_address;
+//entry of every interrupt, INT and external ones alike
+//external interrupts stay masked in the handler until iret restores status
+void Emulator::interrupt(uint32_t cause){
+  this->count(CpuContext::EVENT_INTERRUPT);
+  this->push_status();
+  this->push_pc();
+  this->context.status_registers[2] = cause;
+  this->context.status_registers[0] |= CpuContext::STATUS_INTERRUPTS;
+  this->context.registers[0xF] = this->context.status_registers[1];
 }
 
-uint32_t Emulator::get_segment_value(Segment* s){
-  string result_address = "";
-  for(int j = 3 ; j >= 0 ; --j){
-    result_address+=s->machine_code.at(j).to_string();
+//called between blocks once instructions_retired reaches next_event
+//hart 0 polls the devices, their interrupts go to the hart int_route selects
+//a masked interrupt stays pending, at most one is taken per call
+void Emulator::service_devices(){
+  //anything serviced here may end a wait loop
+  this->idle.armed = true;
+  this->idle.block = nullptr;
+  //code written by the other harts
+  this->code_writes->deliver();
+  //the count run_for was given is reached, due devices are serviced when the run continues, see end_run_for
+  if(this->instructions_retired >= this->stop_at){
+    this->running = false;
+    return;
   }
-  bitset<32> binary_value(result_address);
-  return binary_value.to_ullong();
-}
 
-string Emulator::number_to_binary32_string(uint i){
-  std::bitset<32> binary_representation(i);
-  string binary_string = binary_representation.to_string();
-  return binary_string;
-}
+  if(this->primary != nullptr){
+    if(this->primary->stopping || this->semihost->has_exited()) this->running = false;
+  }
+  else{
+    if(this->stopping) this->running = false;
+    //the other harts stop at their next event as when one of them fails
+    if(this->semihost->has_exited()){
+      this->running = false;
+      this->stopping = true;
+    }
+    //the snapshot is taken before anything is delivered, the restored run delivers it instead
+    if(this->snapshot_pending){
+      if(this->options.snapshot == EmulatorOptions::SNAPSHOT_AT_PC ? this->context.registers[0xF] == this->options.snapshot_at
+                                                                  : this->instructions_retired >= this->options.snapshot_at) this->take_snapshot();
+    }
 
-void Emulator::push_pc(){
-  this->registers[0xE] -= 0x4;
-  Segment* that_segment = this->get_segment_by_address(this->registers[0xE]);
-  string symbol_value = this->number_to_binary32_string(this->registers[0xF]);
+    {
+      //other harts may be writing device registers meanwhile
+      std::lock_guard<std::recursive_mutex> guard(this->memory->get_device_lock());
+      this->timer->update();
+      if(this->timer->expired()) this->router->raise(CpuContext::CAUSE_TIMER);
+      //term_in holds one character, the next one is received after the previous interrupt was taken
+      if(!this->router->is_pending(CpuContext::CAUSE_TERMINAL)) this->receive_input();
+    }
+    this->timer->pace();
+    if(this->debugger != nullptr) this->debugger->service();
+  }
 
-  that_segment->machine_code.clear();
-  //push machine code in segment, literal value of the literal 
-  for (size_t i = 0; i < symbol_value.size(); i += 8) {
-    std::string binaryChunk = symbol_value.substr(i, 8);
-    that_segment->machine_code.push_back(std::bitset<8>(binaryChunk));
+  uint32_t cause = this->interrupts->take(this->context.status_registers[0]);
+  if(cause != 0){
+    //INT is traced as the instruction it is, interrupts taken here get a record of their own
+    if(this->trace_writer != nullptr) this->trace_writer->begin_interrupt(cause, this->context);
+    this->interrupt(cause);
+    if(this->trace_writer != nullptr) this->trace_writer->end(this->context, this->memory);
   }
+  this->schedule_next_event();
+}
 
-  std::reverse(that_segment->machine_code.begin(), that_segment->machine_code.end());
+//host input is the only thing that differs between two runs of an image, so it is where events are recorded and replayed
+//a replayed event is delivered at the instruction count it was recorded at, the host input is ignored meanwhile
+void Emulator::receive_input(){
+  if(this->replayer != nullptr){
+    if(!this->replayer->is_due(this->instructions_retired, EventLogFormat::TERMINAL)) return;
+    this->terminal->deliver(this->replayer->take(this->instructions_retired));
+  }
+  else{
+    if(!this->terminal->has_input()) return;
+    uint8_t character = this->terminal->receive();
+    if(this->recorder != nullptr) this->recorder->record(this->instructions_retired, EventLogFormat::TERMINAL, character);
+  }
+  this->router->raise(CpuContext::CAUSE_TERMINAL);
 }
 
-void Emulator::push_pc_special(){
-  this->registers[0xE] -= 0x4;
-  Segment* that_segment = this->get_segment_by_address(this->registers[0xE]);
-  string symbol_value = this->number_to_binary32_string(this->registers[0xF] + 0x4);
+//next_event is the sooner of the timer deadline and the next input poll
+//the other harts only look at their interrupts and at code written by others
+void Emulator::schedule_next_event(){
+  if(this->primary != nullptr){
+    this->device_event = this->instructions_retired + DEVICE_POLL_INTERVAL;
+    this->set_next_event(this->device_event);
+    return;
+  }
+  uint64_t next = std::min(this->timer->get_deadline(), this->instructions_retired + DEVICE_POLL_INTERVAL);
+  //the recorded run serviced the devices at the replayed count as well, one that is already due waits for the usual poll
+  if(this->replayer != nullptr && this->replayer->get_next_instruction() > this->instructions_retired){
+    next = std::min(next, this->replayer->get_next_instruction());
+  }
+  //a pc is looked for at every block start, blocks are cut at it while the snapshot is pending
+  if(this->snapshot_pending){
+    if(this->options.snapshot == EmulatorOptions::SNAPSHOT_AT_PC) next = this->instructions_retired;
+    else next = std::min(next, this->options.snapshot_at);
+  }
+  this->device_event = next;
+  this->set_next_event(std::min(next, this->stop_at));
+}
 
-  that_segment->machine_code.clear();
-  //push machine code in segment, literal value of the literal 
-  for (size_t i = 0; i < symbol_value.size(); i += 8) {
-    std::string binaryChunk = symbol_value.substr(i, 8);
-    that_segment->machine_code.push_back(std::bitset<8>(binaryChunk));
+//the loop in idle runs the same way until the next event, whole iterations are added to the counts instead of run
+//the event is the soonest of the timer deadline, the next replayed input and a snapshot count, a run_for limit cuts the jump short,
+//the input poll is not one of them: host input arriving meanwhile is taken at the event as if the guest was slower,
+//input that is already waiting is taken at the poll as usual
+//with none of them ahead only host input can end the loop and it keeps running
+bool Emulator::skip_to_event(){
+  if(this->replayer == nullptr && this->terminal->has_input()){
+    this->idle.armed = false;
+    return false;
+  }
+  uint64_t per_iteration = this->instructions_retired - this->idle.instructions_retired;
+  uint64_t due = this->timer->get_deadline();
+  if(this->replayer != nullptr && this->replayer->get_next_instruction() > this->instructions_retired){
+    due = std::min(due, this->replayer->get_next_instruction());
+  }
+  if(this->snapshot_pending && this->options.snapshot == EmulatorOptions::SNAPSHOT_AT_COUNT) due = std::min(due, this->options.snapshot_at);
+  uint64_t target = std::min(due, this->stop_at);
+  if(per_iteration == 0 || due == NO_LIMIT || target <= this->instructions_retired){
+    this->idle.armed = false;
+    return false;
   }
 
-  std::reverse(that_segment->machine_code.begin(), that_segment->machine_code.end());
+  uint64_t iterations = (target - this->instructions_retired + per_iteration - 1) / per_iteration;
+  for(int i = 0 ; i < CpuContext::EVENT_COUNT ; ++i){
+    this->context.events[i] += iterations * (this->context.events[i] - this->idle.events[i]);
+  }
+  this->instructions_retired += iterations * per_iteration;
+  //the skipped polls are not made up for, the devices are next serviced at the event even if run_for stops first
+  this->device_event = std::max(due, this->instructions_retired);
+  this->set_next_event(this->instructions_retired >= due ? this->instructions_retired : this->stop_at);
+  this->idle.block = nullptr;
+  return true;
 }
 
-void Emulator::push_status(){
-  this->registers[0xE] -= 0x4;
-  Segment* that_segment = this->get_segment_by_address(this->registers[0xE]);
-  string symbol_value = this->number_to_binary32_string(this->status_registers[0x0]);
+void Emulator::push_pc(){
+  this->context.registers[0xE] -= 0x4;
+  this->count(CpuContext::EVENT_STORE);
+  this->memory->write_word(this->context.registers[0xE], this->context.registers[0xF]);
+}
 
-  that_segment->machine_code.clear();
-  //push machine code in segment, literal value of the literal 
-  for (size_t i = 0; i < symbol_value.size(); i += 8) {
-    std::string binaryChunk = symbol_value.substr(i, 8);
-    that_segment->machine_code.push_back(std::bitset<8>(binaryChunk));
-  }
+void Emulator::push_pc_special(){
+  this->context.registers[0xE] -= 0x4;
+  this->count(CpuContext::EVENT_STORE);
+  this->memory->write_word(this->context.registers[0xE], this->context.registers[0xF] + 0x4);
+}
 
-  std::reverse(that_segment->machine_code.begin(), that_segment->machine_code.end());
+void Emulator::push_status(){
+  this->context.registers[0xE] -= 0x4;
+  this->count(CpuContext::EVENT_STORE);
+  this->memory->write_word(this->context.registers[0xE], this->context.status_registers[0x0]);
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "../inc/eventLog.hpp"
+#include "../inc/exceptionAlert.hpp"
+#include <cstring>
+
+EventRecorder::EventRecorder(const string& filename){
+  this->file = fopen(filename.c_str(), "wb");
+  if(this->file == nullptr) throw ExceptionAlert("Event log " + filename + " can not be opened.");
+  uint8_t header[EventLogFormat::MAGIC_SIZE + 4];
+  memcpy(header, EventLogFormat::MAGIC, EventLogFormat::MAGIC_SIZE);
+  for(int i = 0 ; i < 4 ; ++i) header[EventLogFormat::MAGIC_SIZE + i] = EventLogFormat::VERSION >> (8 * i);
+  fwrite(header, 1, sizeof(header), this->file);
+  this->last_instruction = 0;
+}
+
+EventRecorder::~EventRecorder(){
+  fclose(this->file);
+}
+
+void EventRecorder::put_varint(uint64_t v){
+  while(v >= 0x80){
+    fputc(static_cast<int>(v & 0x7F) | 0x80, this->file);
+    v >>= 7;
+  }
+  fputc(static_cast<int>(v), this->file);
+}
+
+void EventRecorder::record(uint64_t instruction, uint8_t device, uint32_t value){
+  this->put_varint(instruction - this->last_instruction);
+  fputc(device, this->file);
+  this->put_varint(value);
+  this->last_instruction = instruction;
+}
+
+EventReplayer::EventReplayer(const string& filename){
+  this->next = 0;
+  this->late = 0;
+  FILE* file = fopen(filename.c_str(), "rb");
+  if(file == nullptr) throw ExceptionAlert("Event log " + filename + " can not be opened.");
+  vector<uint8_t> bytes;
+  uint8_t buffer[4096];
+  size_t n;
+  while((n = fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.insert(bytes.end(), buffer, buffer + n);
+  fclose(file);
+
+  const size_t header_size = EventLogFormat::MAGIC_SIZE + 4;
+  if(bytes.size() < header_size || memcmp(bytes.data(), EventLogFormat::MAGIC, EventLogFormat::MAGIC_SIZE) != 0){
+    throw ExceptionAlert(filename + " is not an event log.");
+  }
+  uint32_t version = 0;
+  for(int i = 0 ; i < 4 ; ++i) version |= uint32_t(bytes[EventLogFormat::MAGIC_SIZE + i]) << (8 * i);
+  if(version != EventLogFormat::VERSION) throw ExceptionAlert("Event log " + filename + " has an unsupported version.");
+
+  size_t position = header_size;
+  auto get_varint = [&](uint64_t& v) {
+    v = 0;
+    for(int shift = 0 ; shift < 64 ; shift += 7){
+      if(position == bytes.size()) return false;
+      uint8_t b = bytes[position++];
+      v |= uint64_t(b & 0x7F) << shift;
+      if((b & 0x80) == 0) return true;
+    }
+    return false;
+  };
+  uint64_t instruction = 0;
+  while(position < bytes.size()){
+    uint64_t delta, value;
+    InputEvent event;
+    if(!get_varint(delta) || position == bytes.size()) throw ExceptionAlert("Event log " + filename + " is truncated.");
+    event.device = bytes[position++];
+    if(!get_varint(value)) throw ExceptionAlert("Event log " + filename + " is truncated.");
+    if(event.device != EventLogFormat::TERMINAL) throw ExceptionAlert("Event log " + filename + " names an unknown device.");
+    instruction += delta;
+    event.instruction = instruction;
+    event.value = static_cast<uint32_t>(value);
+    this->events.push_back(event);
+  }
+}
+
+uint32_t EventReplayer::take(uint64_t instruction){
+  const InputEvent& event = this->events[this->next++];
+  if(instruction != event.instruction) ++this->late;
+  return event.value;
+}
@@ -0,0 +1,134 @@
+#include "../inc/hexLoader.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
+
+static inline int hex_digit(char c){
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static inline bool is_blank(char c){
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+//scans one chunk of whole lines, a malformed line stops the chunk with an error
+void HexLoader::scan(Chunk* c){
+  const char* p = c->begin;
+  const char* end = c->end;
+  Run* run = nullptr;
+
+  while(p < end){
+    while(p < end && is_blank(*p)) ++p;
+    if(p == end) break;
+    if(*p == '\n' || *p == '#'){
+      while(p < end && *p != '\n') ++p;
+      ++p;
+      continue;
+    }
+
+    //address
+    if(end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+    uint64_t address = 0;
+    int digits = 0;
+    for(int d ; p < end && (d = hex_digit(*p)) >= 0 ; ++p, ++digits) address = (address << 4) | d;
+    if(digits == 0 || digits > 8){
+      c->error = "Malformed address in the hex image.";
+      return;
+    }
+
+    //bytes
+    size_t line_start = c->bytes.size();
+    for(int column = 0 ; column < BYTES_PER_LINE ; ++column){
+      while(p < end && is_blank(*p)) ++p;
+      if(p == end || *p == '\n' || *p == '#') break;
+      uint32_t value = 0;
+      digits = 0;
+      for(int d ; p < end && (d = hex_digit(*p)) >= 0 ; ++p, ++digits) value = (value << 4) | d;
+      if(digits == 0){
+        c->error = "Malformed byte in the hex image.";
+        return;
+      }
+      c->bytes.push_back(static_cast<uint8_t>(value));
+    }
+    while(p < end && *p != '\n') ++p;
+    ++p;
+
+    size_t size = c->bytes.size() - line_start;
+    if(size == 0) continue;
+    if(run != nullptr && run->offset + run->size == line_start && uint32_t(run->address + run->size) == uint32_t(address)){
+      run->size += size;
+    }
+    else{
+      c->runs.push_back({static_cast<uint32_t>(address), line_start, size});
+      run = &c->runs.back();
+    }
+  }
+}
+
+void HexLoader::load(const string& filename, Memory* m){
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0) throw ExceptionAlert("Input file " + filename + " can not be opened.");
+  struct stat st;
+  if(fstat(fd, &st) != 0){
+    close(fd);
+    throw ExceptionAlert("Input file " + filename + " can not be read.");
+  }
+  size_t size = st.st_size;
+  if(size == 0){
+    close(fd);
+    return;
+  }
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) throw ExceptionAlert("Input file " + filename + " can not be mapped.");
+  madvise(mapping, size, MADV_SEQUENTIAL);
+  try{
+    load_text(static_cast<const char*>(mapping), size, m);
+  }
+  catch(ExceptionAlert& e){
+    munmap(mapping, size);
+    throw;
+  }
+  munmap(mapping, size);
+}
+
+void HexLoader::load_text(const char* text, size_t size, Memory* m){
+  //chunks end right after a newline so no line is split
+  size_t chunk_count = 1;
+  if(size >= PARALLEL_THRESHOLD){
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    chunk_count = std::max<size_t>(1, std::min(threads, size / MIN_CHUNK_SIZE));
+  }
+  vector<Chunk> chunks(chunk_count);
+  const char* begin = text;
+  for(size_t i = 0 ; i < chunk_count ; ++i){
+    const char* end = i + 1 == chunk_count ? text + size : text + size * (i + 1) / chunk_count;
+    while(end < text + size && end[-1] != '\n') ++end;
+    if(end < begin) end = begin;
+    chunks[i].begin = begin;
+    chunks[i].end = end;
+    begin = end;
+  }
+
+  if(chunk_count == 1) scan(&chunks[0]);
+  else{
+    vector<std::thread> workers;
+    for(size_t i = 1 ; i < chunk_count ; ++i) workers.emplace_back(&HexLoader::scan, &chunks[i]);
+    scan(&chunks[0]);
+    for(size_t i = 0 ; i < workers.size() ; ++i) workers[i].join();
+  }
+
+  //runs are copied in file order, so later lines overwrite earlier ones as before
+  for(size_t i = 0 ; i < chunk_count ; ++i){
+    if(!chunks[i].error.empty()) throw ExceptionAlert(chunks[i].error);
+    for(size_t j = 0 ; j < chunks[i].runs.size() ; ++j){
+      const Run& r = chunks[i].runs[j];
+      m->write_bytes(r.address, chunks[i].bytes.data() + r.offset, r.size);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#include "../inc/imageTemplate.hpp"
+#include "../inc/binaryImage.hpp"
+#include "../inc/hexLoader.hpp"
+#include "../inc/mappedImage.hpp"
+
+//the image is loaded into scratch memory the usual way, then every loaded page is written as a whole page,
+//one segment per run of consecutive pages, so every guest page can be mapped from the file
+ImageTemplate::ImageTemplate(const string& image){
+  this->filename = image;
+  this->entry = BinaryImageFormat::DEFAULT_ENTRY;
+
+  Memory scratch;
+  MappedImage* mapped = nullptr;
+  const string extension = ".bin";
+  if(image.size() >= extension.size() && image.compare(image.size() - extension.size(), extension.size(), extension) == 0){
+    mapped = new MappedImage(image);
+    mapped->map_into(&scratch);
+    this->entry = mapped->get_entry();
+  }
+  else HexLoader::load(image, &scratch);
+
+  vector<uint32_t> page_numbers = scratch.get_mapped_pages();
+  std::sort(page_numbers.begin(), page_numbers.end());
+  vector<BinaryImageSegment> segments;
+  for(size_t i = 0 ; i < page_numbers.size() ; ++i){
+    uint32_t address = page_numbers[i] << Memory::PAGE_BITS;
+    if(segments.empty() || segments.back().load_address + segments.back().file_size != address) segments.push_back({address, 0, 0, 0});
+    segments.back().file_size += Memory::PAGE_SIZE;
+  }
+  const uint32_t page_size = BinaryImageFormat::PAGE_SIZE;
+  uint32_t file_offset = (sizeof(BinaryImageHeader) + sizeof(BinaryImageSegment) * segments.size() + page_size - 1) & ~(page_size - 1);
+  for(size_t i = 0 ; i < segments.size() ; ++i){
+    segments[i].file_offset = file_offset;
+    file_offset += segments[i].file_size;
+  }
+
+  BinaryImageHeader header = {};
+  memcpy(header.magic, BinaryImageFormat::MAGIC, strlen(BinaryImageFormat::MAGIC));
+  header.version = BinaryImageFormat::VERSION;
+  header.entry = this->entry;
+  header.segment_count = segments.size();
+
+  this->file = tmpfile();
+  if(this->file == nullptr){
+    delete mapped;
+    throw ExceptionAlert("Template of " + image + " can not be created.");
+  }
+  vector<uint8_t> head(segments.empty() ? page_size : segments[0].file_offset, 0);
+  memcpy(head.data(), &header, sizeof(header));
+  if(!segments.empty()) memcpy(head.data() + sizeof(header), segments.data(), sizeof(BinaryImageSegment) * segments.size());
+  bool written = fwrite(head.data(), 1, head.size(), this->file) == head.size();
+  for(size_t i = 0 ; written && i < page_numbers.size() ; ++i){
+    const uint8_t* page = scratch.get_page_table()[page_numbers[i]];
+    written = fwrite(page, 1, Memory::PAGE_SIZE, this->file) == Memory::PAGE_SIZE;
+  }
+  delete mapped;
+  if(!written || fflush(this->file) != 0){
+    fclose(this->file);
+    throw ExceptionAlert("Template of " + image + " can not be written.");
+  }
+}
+
+ImageTemplate::~ImageTemplate(){
+  fclose(this->file);
+}
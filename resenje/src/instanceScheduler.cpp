@@ -0,0 +1,76 @@
+#include "../inc/instanceScheduler.hpp"
+#include "../inc/workStealingPool.hpp"
+#include <chrono>
+
+InstanceScheduler::InstanceScheduler(uint64_t quantum){
+  if(quantum == 0) throw ExceptionAlert("Scheduler quantum must be at least one instruction.");
+  this->quantum = quantum;
+}
+
+uint32_t InstanceScheduler::add(Emulator* e){
+  uint32_t id = static_cast<uint32_t>(this->instances.size());
+  this->instances.push_back({e, RUNNABLE, false, 0, 0, ""});
+  if(e->is_finished()) this->instances[id].state = FINISHED;
+  else this->enqueue(id);
+  return id;
+}
+
+void InstanceScheduler::enqueue(uint32_t id){
+  Instance& instance = this->instances[id];
+  instance.state = RUNNABLE;
+  if(instance.queued) return;
+  instance.queued = true;
+  this->runnable.push_back(id);
+}
+
+void InstanceScheduler::send_input(uint32_t id, const string& text){
+  Instance& instance = this->instances[id];
+  instance.emulator->send_input(text);
+  if(instance.state == PARKED) this->enqueue(id);
+}
+
+void InstanceScheduler::run_slice(uint32_t id){
+  Instance& instance = this->instances[id];
+  Emulator* e = instance.emulator;
+  const CpuContext& c = e->get_context();
+  uint64_t stores = c.events[CpuContext::EVENT_STORE];
+  uint64_t interrupts = c.events[CpuContext::EVENT_INTERRUPT];
+  auto start_time = std::chrono::steady_clock::now();
+  try{
+    e->run_for(this->quantum);
+    //a slice that wrote nothing and took no interrupt may be a wait loop, the probe makes sure
+    if(!e->is_finished() && c.events[CpuContext::EVENT_STORE] == stores && c.events[CpuContext::EVENT_INTERRUPT] == interrupts
+       && !e->can_take_interrupt(CpuContext::CAUSE_TIMER) && !e->has_input_waiting() && e->is_waiting(PROBE_STEPS)){
+      instance.state = PARKED;
+    }
+    if(e->is_finished()) instance.state = FINISHED;
+  }
+  catch(ExceptionAlert& alert){
+    instance.state = FAILED;
+    instance.failure = alert.get_message();
+  }
+  instance.host_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+  ++instance.slices;
+}
+
+void InstanceScheduler::run(uint threads){
+  if(threads <= 1){
+    while(!this->runnable.empty()){
+      uint32_t id = this->runnable.front();
+      this->runnable.pop_front();
+      this->instances[id].queued = false;
+      this->run_slice(id);
+      if(this->instances[id].state == RUNNABLE) this->enqueue(id);
+    }
+    return;
+  }
+  //the pool keeps the queues, a slice touches only its own instance
+  vector<uint32_t> ids(this->runnable.begin(), this->runnable.end());
+  this->runnable.clear();
+  for(size_t i = 0 ; i < ids.size() ; ++i) this->instances[ids[i]].queued = false;
+  WorkStealingPool pool(threads);
+  pool.run_slices(ids.size(), [this, &ids](size_t task) {
+    this->run_slice(ids[task]);
+    return this->instances[ids[task]].state == RUNNABLE;
+  });
+}
@@ -0,0 +1,421 @@
+#include "../inc/emulator.hpp"
+
+//threaded interpreter core
+//every (opcode, mode) pair gets its own handler generated from the template below,
+//the loop only fetches the predecoded instruction and calls the handler selected by byte I
+
+template<uint8_t OPCODE, uint8_t MODE>
+void Emulator::execute(Emulator* e, const DecodedInstruction& d){
+  uint32_t* r = e->context.registers;
+  uint32_t* csr = e->context.status_registers;
+  Memory* memory = e->memory;
+
+  if constexpr (OPCODE == 0x0){ //HALT
+    e->running = false;
+    e->halted = true;
+  }
+  else if constexpr (OPCODE == 0x1){ //INT
+    e->interrupt(CpuContext::CAUSE_SOFTWARE);
+  }
+  else if constexpr (OPCODE == 0x2 && MODE == 0x0){ //CALL gpr[A] + gpr[B] + D
+    e->push_pc();
+    r[0xF] = r[d.a] + r[d.b] + d.d;
+  }
+  else if constexpr (OPCODE == 0x2 && MODE == 0x1){ //CALL mem[gpr[A] + gpr[B] + D], literal follows the instruction
+    e->push_pc_special();
+    e->count(CpuContext::EVENT_LOAD);
+    r[0xF] = memory->read_word(r[d.a] + r[d.b] + d.d);
+  }
+  else if constexpr (OPCODE == 0x3 && MODE == 0x0){ //JMP
+    e->count(CpuContext::EVENT_BRANCH);
+    r[0xF] = r[d.a] + d.d;
+  }
+  else if constexpr (OPCODE == 0x3 && MODE == 0x1){ //BEQ
+    if(r[d.b] == r[d.c]){
+      e->count(CpuContext::EVENT_BRANCH);
+      r[0xF] = r[d.a] + d.d;
+    }
+  }
+  else if constexpr (OPCODE == 0x3 && MODE == 0x2){ //BNE
+    if(r[d.b] != r[d.c]){
+      e->count(CpuContext::EVENT_BRANCH);
+      r[0xF] = r[d.a] + d.d;
+    }
+  }
+  else if constexpr (OPCODE == 0x3 && MODE == 0x3){ //BGT
+    if(static_cast<int32_t>(r[d.b]) > static_cast<int32_t>(r[d.c])){
+      e->count(CpuContext::EVENT_BRANCH);
+      r[0xF] = r[d.a] + d.d;
+    }
+  }
+  else if constexpr (OPCODE == 0x3 && MODE == 0x8){ //JMP mem
+    e->count(CpuContext::EVENT_BRANCH);
+    e->count(CpuContext::EVENT_LOAD);
+    r[0xF] = memory->read_word(r[d.a] + d.d);
+  }
+  else if constexpr (OPCODE == 0x3 && MODE == 0x9){ //BEQ mem
+    if(r[d.b] == r[d.c]){
+      e->count(CpuContext::EVENT_BRANCH);
+      e->count(CpuContext::EVENT_LOAD);
+      r[0xF] = memory->read_word(r[d.a] + d.d);
+    }
+  }
+  else if constexpr (OPCODE == 0x3 && MODE == 0xA){ //BNE mem
+    if(r[d.b] != r[d.c]){
+      e->count(CpuContext::EVENT_BRANCH);
+      e->count(CpuContext::EVENT_LOAD);
+      r[0xF] = memory->read_word(r[d.a] + d.d);
+    }
+  }
+  else if constexpr (OPCODE == 0x3 && MODE == 0xB){ //BGT mem
+    if(static_cast<int32_t>(r[d.b]) > static_cast<int32_t>(r[d.c])){
+      e->count(CpuContext::EVENT_BRANCH);
+      e->count(CpuContext::EVENT_LOAD);
+      r[0xF] = memory->read_word(r[d.a] + d.d);
+    }
+  }
+  else if constexpr (OPCODE == 0x4 && MODE == 0x0){ //XCHG
+    uint32_t temp = r[d.b];
+    r[d.b] = r[d.c];
+    r[d.c] = temp;
+  }
+  else if constexpr (OPCODE == 0x4 && MODE == 0x1){ //XCHG mem[gpr[B] + D] <=> gpr[C], atomic between harts
+    e->count(CpuContext::EVENT_LOAD);
+    e->count(CpuContext::EVENT_STORE);
+    r[d.c] = memory->exchange_word(r[d.b] + d.d, r[d.c]);
+  }
+  else if constexpr (OPCODE == 0x5 && MODE == 0x0){ //ADD
+    r[d.a] = r[d.b] + r[d.c];
+  }
+  else if constexpr (OPCODE == 0x5 && MODE == 0x1){ //SUB
+    r[d.a] = r[d.b] - r[d.c];
+  }
+  else if constexpr (OPCODE == 0x5 && MODE == 0x2){ //MUL
+    r[d.a] = r[d.b] * r[d.c];
+  }
+  else if constexpr (OPCODE == 0x5 && MODE == 0x3){ //DIV
+    r[d.a] = r[d.b] / r[d.c];
+  }
+  else if constexpr (OPCODE == 0x5 && MODE == 0x4){ //ADD with shifted operand, direction is in D[11:8]
+    if(((d.raw >> 16) & 0xF) == 0) r[d.a] = r[d.b] + (r[d.c] << d.d);
+    else r[d.a] = r[d.b] + (r[d.c] >> d.d);
+  }
+  else if constexpr (OPCODE == 0x6 && MODE == 0x0){ //NOT
+    r[d.a] = ~r[d.b];
+  }
+  else if constexpr (OPCODE == 0x6 && MODE == 0x1){ //AND
+    r[d.a] = r[d.b] & r[d.c];
+  }
+  else if constexpr (OPCODE == 0x6 && MODE == 0x2){ //OR
+    r[d.a] = r[d.b] | r[d.c];
+  }
+  else if constexpr (OPCODE == 0x6 && MODE == 0x3){ //XOR
+    r[d.a] = r[d.b] ^ r[d.c];
+  }
+  else if constexpr (OPCODE == 0x7 && MODE == 0x0){ //SHL
+    r[d.a] = r[d.b] << r[d.c];
+  }
+  else if constexpr (OPCODE == 0x7 && MODE == 0x1){ //SHR
+    r[d.a] = r[d.b] >> r[d.c];
+  }
+  else if constexpr (OPCODE == 0x8 && (MODE == 0x0 || MODE == 0x3)){ //ST mem[gpr[A] + gpr[B] + D]
+    e->count(CpuContext::EVENT_STORE);
+    memory->write_word(r[d.a] + r[d.b] + d.d, r[d.c]);
+  }
+  else if constexpr (OPCODE == 0x8 && MODE == 0x1){ //PUSH
+    e->count(CpuContext::EVENT_STORE);
+    r[d.a] += d.d;
+    memory->write_word(r[d.a], r[d.c]);
+  }
+  else if constexpr (OPCODE == 0x8 && MODE == 0x2){ //ST mem[mem[gpr[A] + gpr[B] + D]]
+    e->count(CpuContext::EVENT_LOAD);
+    e->count(CpuContext::EVENT_STORE);
+    memory->write_word(memory->read_word(r[d.a] + r[d.b] + d.d), r[d.c]);
+  }
+  else if constexpr (OPCODE == 0x9 && MODE == 0x0){ //CSRRD
+    r[d.a] = e->read_csr(d.b);
+  }
+  else if constexpr (OPCODE == 0x9 && MODE == 0x1){ //LD gpr[B] + D
+    r[d.a] = r[d.b] + d.d;
+  }
+  else if constexpr (OPCODE == 0x9 && (MODE == 0x2 || MODE == 0x8)){ //LD mem[gpr[B] + gpr[C] + D]
+    e->count(CpuContext::EVENT_LOAD);
+    r[d.a] = memory->read_word(r[d.b] + r[d.c] + d.d);
+  }
+  else if constexpr (OPCODE == 0x9 && MODE == 0x3){ //POP, IRET is a macro-op
+    e->count(CpuContext::EVENT_LOAD);
+    r[d.a] = memory->read_word(r[d.b]);
+    r[d.b] += d.d;
+  }
+  else if constexpr (OPCODE == 0x9 && MODE == 0x4){ //CSRWR
+    if(d.a < CpuContext::WRITABLE_CSRS) csr[d.a] = r[d.b];
+    if(d.a == 0) e->interrupts->mask_changed();
+  }
+  else if constexpr (OPCODE == 0x9 && MODE == 0x5){ //csr[A] <= csr[B] | D
+    uint32_t v = e->read_csr(d.b) | d.d;
+    if(d.a < CpuContext::WRITABLE_CSRS) csr[d.a] = v;
+    if(d.a == 0) e->interrupts->mask_changed();
+  }
+  else if constexpr (OPCODE == 0x9 && MODE == 0x6){ //csr[A] <= mem[gpr[B] + gpr[C] + D]
+    e->count(CpuContext::EVENT_LOAD);
+    uint32_t v = memory->read_word(r[d.b] + r[d.c] + d.d);
+    if(d.a < CpuContext::WRITABLE_CSRS) csr[d.a] = v;
+    if(d.a == 0) e->interrupts->mask_changed();
+  }
+  else if constexpr (OPCODE == 0x9 && MODE == 0x7){ //POP csr
+    e->count(CpuContext::EVENT_LOAD);
+    uint32_t v = memory->read_word(r[d.b]);
+    if(d.a < CpuContext::WRITABLE_CSRS) csr[d.a] = v;
+    r[d.b] += d.d;
+    if(d.a == 0) e->interrupts->mask_changed();
+  }
+  else{
+    std::stringstream exact_error_stream;
+    exact_error_stream << std::hex << std::setw(8) << std::setfill('0') << d.raw;
+    throw ExceptionAlert("Unknown operation code: " + exact_error_stream.str());
+  }
+}
+
+//sequences recognized by the decode cache, pc points past the first word as for any instruction
+//literals are read at decode time but still counted as loads, the counters see the same events as without fusion
+template<uint8_t KIND>
+void Emulator::execute_macro(Emulator* e, const DecodedInstruction& d){
+  uint32_t* r = e->context.registers;
+  Memory* memory = e->memory;
+
+  if constexpr (KIND == MacroOp::IRET){ //pc and status are popped in one step
+    e->context.events[CpuContext::EVENT_LOAD] += 2;
+    r[0xF] = memory->read_word(r[0xE]);
+    r[0xE] += 4;
+    e->context.status_registers[0] = memory->read_word(r[0xE]);
+    r[0xE] += 4;
+    e->interrupts->mask_changed();
+  }
+  else if constexpr (KIND == MacroOp::LOAD_LITERAL){
+    e->count(CpuContext::EVENT_LOAD);
+    r[d.a] = d.literal;
+    r[0xF] += 4;
+  }
+  else if constexpr (KIND == MacroOp::BRANCH_LITERAL){
+    bool taken;
+    switch(d.mode & 0x3){
+      case 0x0: taken = true; break;
+      case 0x1: taken = r[d.b] == r[d.c]; break;
+      case 0x2: taken = r[d.b] != r[d.c]; break;
+      default: taken = static_cast<int32_t>(r[d.b]) > static_cast<int32_t>(r[d.c]); break;
+    }
+    if(taken){
+      e->count(CpuContext::EVENT_BRANCH);
+      e->count(CpuContext::EVENT_LOAD);
+      r[0xF] = d.literal;
+    }
+    else{
+      //the skip over the literal still counts as retired, so virtual time is the same as without fusion
+      r[0xF] += 8;
+      ++e->instructions_retired;
+    }
+  }
+  else if constexpr (KIND == MacroOp::CALL_LITERAL){
+    e->push_pc_special();
+    e->count(CpuContext::EVENT_LOAD);
+    r[0xF] = d.literal;
+  }
+  else throw ExceptionAlert("Unknown macro-op " + std::to_string(KIND) + ".");
+}
+
+bool Emulator::is_implemented(uint8_t opcode, uint8_t mode){
+  switch(opcode){
+    case 0x0: case 0x1: return true;
+    case 0x2: return mode <= 0x1;
+    case 0x3: return mode <= 0x3 || (mode >= 0x8 && mode <= 0xB);
+    case 0x4: return mode <= 0x1;
+    case 0x5: return mode <= 0x4;
+    case 0x6: return mode <= 0x3;
+    case 0x7: return mode <= 0x1;
+    case 0x8: return mode <= 0x3;
+    case 0x9: return mode <= 0x8;
+    default: return false;
+  }
+}
+
+template<size_t INDEX>
+constexpr Emulator::Handler Emulator::handler_at(){
+  if constexpr (INDEX < MacroOp::HANDLER_BASE) return &Emulator::execute<(INDEX >> 4), (INDEX & 0xF)>;
+  else return &Emulator::execute_macro<INDEX - MacroOp::HANDLER_BASE>;
+}
+
+template<size_t... INDEX>
+constexpr auto Emulator::make_handler_table(std::index_sequence<INDEX...>) -> std::array<Handler, HANDLER_COUNT>{
+  return {{ handler_at<INDEX>()... }};
+}
+
+const std::array<Emulator::Handler, Emulator::HANDLER_COUNT> Emulator::handler_table = Emulator::make_handler_table(std::make_index_sequence<HANDLER_COUNT>());
+
+template<class Trace>
+void Emulator::emulate_threaded(){
+  this->running = true;
+  while(this->running){
+    if(this->instructions_retired >= this->get_next_event()){
+      this->service_devices();
+      if(!this->running) break;
+    }
+    //every instruction is a block entry for this core
+    if(Trace::breakpoints && this->debugger->should_stop(this->context.registers[0xF])){
+      this->debugger->stop("at a breakpoint");
+      if(!this->running) break;
+    }
+    this->current_address = this->context.registers[0xF];
+    this->context.registers[0xF] += 0x4;
+    const DecodedInstruction& decoded = this->decode_cache->fetch(this->current_address);
+    Trace::before(this, decoded);
+    handler_table[decoded.handler](this, decoded);
+    Trace::after(this);
+    ++this->instructions_retired;
+  }
+}
+
+//one instruction outside of the cores, for the debugger
+void Emulator::step_instruction(){
+  this->current_address = this->context.registers[0xF];
+  this->context.registers[0xF] += 0x4;
+  const DecodedInstruction& decoded = this->decode_cache->fetch(this->current_address);
+  handler_table[decoded.handler](this, decoded);
+  ++this->instructions_retired;
+}
+
+//returns the statically known address of the instruction after d, or 0 if d ends a block
+//literal loads and skips move the PC by a constant, every other write to the PC ends the block
+static uint32_t next_static_address(const DecodedInstruction& d, uint32_t a){
+  const uint32_t pc = 0xF;
+  if(d.macro == MacroOp::LOAD_LITERAL) return a + 8;
+  if(d.macro != MacroOp::NONE) return 0;
+  switch(d.opcode){
+    case 0x0: case 0x1: case 0x2: case 0x3:
+      return 0;
+    case 0x4:
+      return (d.b == pc || d.c == pc) ? 0 : a + 4;
+    case 0x5: case 0x6: case 0x7:
+      return d.a == pc ? 0 : a + 4;
+    case 0x8:
+      return (d.mode == 0x1 && d.a == pc) ? 0 : a + 4;
+    case 0x9:
+      switch(d.mode){
+        case 0x0: case 0x2: case 0x8:
+          return d.a == pc ? 0 : a + 4;
+        case 0x1: //gpr[A] <= gpr[B] + D
+          if(d.a != pc) return a + 4;
+          return d.b == pc ? a + 4 + d.d : 0;
+        case 0x3: //gpr[A] <= mem[gpr[B]], gpr[B] += D
+          if(d.a == pc) return 0;
+          return d.b == pc ? a + 4 + d.d : a + 4;
+        case 0x7: //csr[A] <= mem[gpr[B]], gpr[B] += D
+          return d.b == pc ? a + 4 + d.d : a + 4;
+        case 0x4: case 0x5: case 0x6:
+          return a + 4;
+        default:
+          return 0;
+      }
+    default:
+      return 0;
+  }
+}
+
+//a wait loop only reads, instructions that store, change csrs or trap make the block progress on their own
+bool Emulator::may_idle(const DecodedInstruction& d){
+  if(d.macro != MacroOp::NONE) return d.macro == MacroOp::LOAD_LITERAL || d.macro == MacroOp::BRANCH_LITERAL;
+  if(!is_implemented(d.opcode, d.mode)) return false;
+  switch(d.opcode){
+    case 0x3: case 0x5: case 0x6: case 0x7: return true;
+    case 0x4: return d.mode == 0x0;
+    case 0x9: return d.mode < 0x4 || d.mode > 0x7;
+    default: return false;
+  }
+}
+
+bool Emulator::may_idle(const TranslatedBlock* b){
+  if(b->ops.size() > IDLE_MAX_LENGTH) return false;
+  for(size_t i = 0 ; i < b->ops.size() ; ++i){
+    if(!may_idle(b->ops[i].decoded)) return false;
+  }
+  return true;
+}
+
+//translates straight-line code starting at a into a block of micro-ops
+TranslatedBlock* Emulator::translate_block(uint32_t a){
+  TranslatedBlock* block = new TranslatedBlock(a);
+  uint32_t address = a;
+  while(block->ops.size() < BlockCache::MAX_BLOCK_LENGTH){
+    MicroOp op;
+    op.decoded = this->decode_cache->fetch(address);
+    op.handler = handler_table[op.decoded.handler];
+    op.address = address;
+    block->ops.push_back(op);
+
+    uint32_t next = next_static_address(op.decoded, address);
+    //literals skipped by the instruction are part of the block, writes to them drop it too
+    block->end_address = std::max(address + 4 * op.decoded.words, next);
+    if(next == 0) break;
+    if(this->snapshot_pending && this->options.snapshot == EmulatorOptions::SNAPSHOT_AT_PC && next == this->options.snapshot_at) break;
+    if(this->debugger != nullptr && this->debugger->is_breakpoint(next)) break;
+    address = next;
+  }
+  block->may_idle = this->skip_idle && may_idle(block);
+  this->block_cache->add(block);
+  return block;
+}
+
+//block core, executes translated blocks and follows the chains between them
+template<class Trace>
+void Emulator::emulate_blocks(){
+  this->running = true;
+  TranslatedBlock* block = nullptr;
+  while(this->running){
+    //devices and interrupts are serviced between blocks
+    if(this->instructions_retired >= this->get_next_event()){
+      this->service_devices();
+      if(!this->running) break;
+    }
+    uint32_t pc = this->context.registers[0xF];
+    if(Trace::breakpoints && this->debugger->should_stop(pc)){
+      this->debugger->stop("at a breakpoint");
+      if(!this->running) break;
+      //steps may have moved the pc
+      pc = this->context.registers[0xF];
+      block = nullptr;
+    }
+    //a block dropped by a store into its own code may be freed by the next translation
+    if(block != nullptr && !block->valid) block = nullptr;
+    TranslatedBlock* next = block != nullptr ? block->get_successor(pc) : nullptr;
+    if(next == nullptr){
+      next = this->block_cache->find(pc);
+      if(next == nullptr) next = this->translate_block(pc);
+      if(block != nullptr) block->chain(pc, next);
+    }
+    //a block that runs again right after itself may be waiting for an event
+    if(!Trace::enabled && !Trace::breakpoints && next == block && next->may_idle && this->idle.armed && this->watch_idle(next)) continue;
+    block = next;
+
+    //native blocks can not be traced, the JIT is only used without tracing
+    if(!Trace::enabled && this->jit != nullptr){
+      if(block->native == nullptr && ++block->execution_count == JitCompiler::HOT_THRESHOLD) block->native = this->jit->compile(block);
+      if(block->native != nullptr){
+        this->instructions_retired += block->native(&this->context, this, this->memory->get_page_table(), this->memory->get_page_flag_table(),
+                                                     this->memory->get_device_span_table());
+        if(this->jit->has_failed()) this->jit->take_failure();
+        continue;
+      }
+    }
+
+    for(size_t i = 0 ; i < block->ops.size() ; ++i){
+      const MicroOp& op = block->ops[i];
+      this->current_address = op.address;
+      this->context.registers[0xF] = op.address + 0x4;
+      Trace::before(this, op.decoded);
+      op.handler(this, op.decoded);
+      Trace::after(this);
+      ++this->instructions_retired;
+      //the rest of the block is stale after a store into it
+      if(!block->valid) break;
+    }
+  }
+}
@@ -0,0 +1,381 @@
+#include "../inc/emulator.hpp"
+#include "../inc/jit.hpp"
+#include <sys/mman.h>
+
+//host registers while a native block runs:
+//rbx = CpuContext*, r12 = Emulator*, r13 = page table, r14 = page flag table, r15 = device span table
+//eax, ecx, edx, esi, edi, r8 are scratch, guest registers always live in the context
+static const uint8_t EAX = 0;
+static const uint8_t ECX = 1;
+static const uint8_t EDX = 2;
+
+static const uint8_t PC_OFFSET = offsetof(CpuContext, registers) + 4 * 0xF;
+
+JitCompiler::JitCompiler(){
+  this->arena = nullptr;
+  this->arena_used = 0;
+  this->compiled_blocks = 0;
+  this->available = false;
+  this->failed = false;
+#if defined(__x86_64__)
+  void* pages = mmap(nullptr, ARENA_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(pages != MAP_FAILED){
+    this->arena = static_cast<uint8_t*>(pages);
+    this->available = true;
+  }
+#endif
+}
+
+JitCompiler::~JitCompiler(){
+  if(this->arena != nullptr) munmap(this->arena, ARENA_SIZE);
+}
+
+//the helpers run the C++ side of an instruction, an exception is kept until the native block returned
+void JitCompiler::fail(std::exception_ptr f){
+  this->failed = true;
+  this->failure = f;
+}
+
+uint64_t JitCompiler::load_helper(Emulator* e, uint32_t a){
+  try{
+    return e->memory->read_word(a);
+  }
+  catch(...){
+    e->jit->fail(std::current_exception());
+    return uint64_t(1) << 32;
+  }
+}
+
+bool JitCompiler::store_helper(Emulator* e, uint32_t a, uint32_t v){
+  try{
+    e->memory->write_word(a, v);
+    return false;
+  }
+  catch(...){
+    e->jit->fail(std::current_exception());
+    return true;
+  }
+}
+
+//instructions_retired is only brought up to date when a native block returns,
+//a counter csr read from inside one would see the count from the start of the block
+static bool reads_counter(const DecodedInstruction& d){
+  return d.macro == MacroOp::NONE && d.opcode == 0x9 && (d.mode == 0x0 || d.mode == 0x5) && d.b >= CpuContext::CSR_INSTRET;
+}
+
+bool JitCompiler::interpret_helper(Emulator* e, const MicroOp* op){
+  e->current_address = op->address;
+  try{
+    op->handler(e, op->decoded);
+    return false;
+  }
+  catch(...){
+    e->jit->fail(std::current_exception());
+    return true;
+  }
+}
+
+void JitCompiler::take_failure(){
+  std::exception_ptr f = this->failure;
+  this->failed = false;
+  this->failure = nullptr;
+  std::rethrow_exception(f);
+}
+
+//instructions emitted inline, everything else calls the interpreter handler
+bool JitCompiler::is_native(const TranslatedBlock* b, size_t i) const {
+  const DecodedInstruction& d = b->ops[i].decoded;
+  if(d.macro == MacroOp::LOAD_LITERAL) return true;
+  if(d.macro != MacroOp::NONE) return false;
+  switch(d.opcode){
+    case 0x4: return d.mode == 0x0;
+    case 0x5: return d.mode <= 0x2;
+    case 0x6: return d.mode <= 0x3;
+    case 0x7: return d.mode <= 0x1;
+    case 0x8: return d.mode == 0x0 || d.mode == 0x1 || d.mode == 0x3;
+    case 0x9: return d.mode == 0x1 || d.mode == 0x2 || d.mode == 0x8 || (d.mode == 0x3 && d.a != 0xF);
+    default: return false;
+  }
+}
+
+void JitCompiler::emit(std::initializer_list<uint8_t> bytes){
+  this->code.insert(this->code.end(), bytes);
+}
+
+void JitCompiler::emit32(uint32_t v){
+  for(int i = 0 ; i < 4 ; ++i) this->code.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+void JitCompiler::emit64(uint64_t v){
+  for(int i = 0 ; i < 8 ; ++i) this->code.push_back(static_cast<uint8_t>(v >> (8 * i)));
+}
+
+//emits a jump with a 32-bit displacement, returns the position of the displacement for patch_jump
+size_t JitCompiler::emit_jump(std::initializer_list<uint8_t> opcode){
+  this->emit(opcode);
+  size_t position = this->code.size();
+  this->emit32(0);
+  return position;
+}
+
+//points the jump at position to the current end of the code
+void JitCompiler::patch_jump(size_t position){
+  uint32_t displacement = static_cast<uint32_t>(this->code.size() - (position + 4));
+  for(int i = 0 ; i < 4 ; ++i) this->code[position + i] = static_cast<uint8_t>(displacement >> (8 * i));
+}
+
+void JitCompiler::emit_prologue(){
+  this->emit({0x53});               //push rbx
+  this->emit({0x41, 0x54});         //push r12
+  this->emit({0x41, 0x55});         //push r13
+  this->emit({0x41, 0x56});         //push r14
+  this->emit({0x41, 0x57});         //push r15, also keeps the stack 16 byte aligned for calls
+  this->emit({0x48, 0x89, 0xFB});   //mov rbx, rdi
+  this->emit({0x49, 0x89, 0xF4});   //mov r12, rsi
+  this->emit({0x49, 0x89, 0xD5});   //mov r13, rdx
+  this->emit({0x49, 0x89, 0xCE});   //mov r14, rcx
+  this->emit({0x4D, 0x89, 0xC7});   //mov r15, r8
+}
+
+//returns from the native block reporting how many guest instructions were executed
+void JitCompiler::emit_exit(uint32_t executed){
+  this->emit({0xB8}); this->emit32(executed);   //mov eax, executed
+  this->emit({0x41, 0x5F});         //pop r15
+  this->emit({0x41, 0x5E});         //pop r14
+  this->emit({0x41, 0x5D});         //pop r13
+  this->emit({0x41, 0x5C});         //pop r12
+  this->emit({0x5B});               //pop rbx
+  this->emit({0xC3});               //ret
+}
+
+//mov host, [rbx + 4 * guest]
+void JitCompiler::emit_load_register(uint8_t host, uint8_t guest){
+  this->emit({0x8B, static_cast<uint8_t>(0x43 | (host << 3)), static_cast<uint8_t>(4 * guest)});
+}
+
+//mov [rbx + 4 * guest], host
+void JitCompiler::emit_store_register(uint8_t guest, uint8_t host){
+  this->emit({0x89, static_cast<uint8_t>(0x43 | (host << 3)), static_cast<uint8_t>(4 * guest)});
+}
+
+//eax <= gpr[a] + gpr[b] + d
+void JitCompiler::emit_effective_address(uint8_t a, uint8_t b, int32_t d){
+  this->emit_load_register(EAX, a);
+  this->emit({0x03, 0x43, static_cast<uint8_t>(4 * b)});                  //add eax, [rbx + 4 * b]
+  if(d != 0){ this->emit({0x05}); this->emit32(static_cast<uint32_t>(d)); } //add eax, d
+}
+
+//leaves the block when the flags a helper's result was tested into are not zero, the failing instruction did not retire
+void JitCompiler::emit_exit_if_failed(uint32_t executed){
+  size_t ok = this->emit_jump({0x0F, 0x84});                    //jz ok
+  this->emit_exit(executed - 1);
+  this->patch_jump(ok);
+}
+
+//eax <= mem32[eax], pages that are not mapped or words crossing a page go through the helper
+void JitCompiler::emit_memory_load(uint32_t executed){
+  this->emit({0x89, 0xC6});                       //mov esi, eax
+  this->emit({0xC1, 0xE8, Memory::PAGE_BITS});    //shr eax, PAGE_BITS
+  this->emit({0x49, 0x8B, 0x54, 0xC5, 0x00});     //mov rdx, [r13 + rax * 8]
+  this->emit({0x48, 0x85, 0xD2});                 //test rdx, rdx
+  size_t unmapped = this->emit_jump({0x0F, 0x84});              //jz slow
+  this->emit({0x89, 0xF1});                       //mov ecx, esi
+  this->emit({0x81, 0xE1}); this->emit32(Memory::PAGE_MASK);    //and ecx, PAGE_MASK
+  this->emit({0x81, 0xF9}); this->emit32(Memory::PAGE_SIZE - 4);//cmp ecx, PAGE_SIZE - 4
+  size_t crossing = this->emit_jump({0x0F, 0x87});              //ja slow
+  this->emit({0x8B, 0x04, 0x0A});                 //mov eax, [rdx + rcx]
+  size_t done = this->emit_jump({0xE9});                        //jmp done
+  this->patch_jump(unmapped);
+  this->patch_jump(crossing);
+  this->emit({0x4C, 0x89, 0xE7});                 //mov rdi, r12
+  this->emit({0x48, 0xB8}); this->emit64(reinterpret_cast<uint64_t>(&JitCompiler::load_helper));
+  this->emit({0xFF, 0xD0});                       //call rax
+  this->emit({0x48, 0x89, 0xC1});                 //mov rcx, rax
+  this->emit({0x48, 0xC1, 0xE9, 0x20});           //shr rcx, 32
+  this->emit_exit_if_failed(executed);
+  this->patch_jump(done);
+}
+
+//mem32[eax] <= edx, flagged pages (translated code, watched) and stores meeting device registers go through the helper
+//a store through the helper may drop the block itself, native code then leaves after the store
+void JitCompiler::emit_memory_store(const TranslatedBlock* b, uint32_t executed){
+  this->emit({0x89, 0xC6});                       //mov esi, eax
+  this->emit({0xC1, 0xE8, Memory::PAGE_BITS});    //shr eax, PAGE_BITS
+  this->emit({0x41, 0x0F, 0xB6, 0x0C, 0x06});     //movzx ecx, byte [r14 + rax]
+  this->emit({0x85, 0xC9});                       //test ecx, ecx
+  size_t unflagged = this->emit_jump({0x0F, 0x84});             //jz plain
+  this->emit({0x83, 0xF9, Memory::PAGE_MMIO});    //cmp ecx, PAGE_MMIO
+  size_t flagged = this->emit_jump({0x0F, 0x85});               //jne slow
+  //same test as Memory::must_report, first - 3 <= offset < first + covered as one unsigned compare
+  this->emit({0x41, 0x8B, 0x0C, 0x87});           //mov ecx, [r15 + rax * 4]
+  this->emit({0x89, 0xF7});                       //mov edi, esi
+  this->emit({0x81, 0xE7}); this->emit32(Memory::PAGE_MASK);    //and edi, PAGE_MASK
+  this->emit({0x83, 0xC7, 0x03});                 //add edi, 3
+  this->emit({0x44, 0x0F, 0xB7, 0xC1});           //movzx r8d, cx
+  this->emit({0x44, 0x29, 0xC7});                 //sub edi, r8d
+  this->emit({0xC1, 0xE9, 0x10});                 //shr ecx, 16
+  this->emit({0x83, 0xC1, 0x03});                 //add ecx, 3
+  this->emit({0x39, 0xCF});                       //cmp edi, ecx
+  size_t device = this->emit_jump({0x0F, 0x82});                //jb slow
+  this->patch_jump(unflagged);
+  this->emit({0x49, 0x8B, 0x4C, 0xC5, 0x00});     //mov rcx, [r13 + rax * 8]
+  this->emit({0x48, 0x85, 0xC9});                 //test rcx, rcx
+  size_t unmapped = this->emit_jump({0x0F, 0x84});              //jz slow
+  this->emit({0x89, 0xF0});                       //mov eax, esi
+  this->emit({0x25}); this->emit32(Memory::PAGE_MASK);          //and eax, PAGE_MASK
+  this->emit({0x3D}); this->emit32(Memory::PAGE_SIZE - 4);      //cmp eax, PAGE_SIZE - 4
+  size_t crossing = this->emit_jump({0x0F, 0x87});              //ja slow
+  this->emit({0x89, 0x14, 0x01});                 //mov [rcx + rax], edx
+  size_t done = this->emit_jump({0xE9});                        //jmp done
+  this->patch_jump(flagged);
+  this->patch_jump(device);
+  this->patch_jump(unmapped);
+  this->patch_jump(crossing);
+  this->emit({0x4C, 0x89, 0xE7});                 //mov rdi, r12
+  this->emit({0x48, 0xB8}); this->emit64(reinterpret_cast<uint64_t>(&JitCompiler::store_helper));
+  this->emit({0xFF, 0xD0});                       //call rax
+  this->emit({0x84, 0xC0});                       //test al, al
+  this->emit_exit_if_failed(executed);
+  this->emit({0x48, 0xB8}); this->emit64(reinterpret_cast<uint64_t>(&b->valid));
+  this->emit({0x80, 0x38, 0x00});                 //cmp byte [rax], 0
+  size_t still_valid = this->emit_jump({0x0F, 0x85});           //jne done
+  this->emit_exit(executed);
+  this->patch_jump(still_valid);
+  this->patch_jump(done);
+}
+
+//add qword [rbx + events[event]], 1, interpreted instructions count their own events
+void JitCompiler::emit_count(CpuContext::Event event){
+  this->emit({0x48, 0x83, 0x83}); this->emit32(static_cast<uint32_t>(offsetof(CpuContext, events) + 8 * event)); this->emit({0x01});
+}
+
+void JitCompiler::emit_interpreter_call(const TranslatedBlock* b, const MicroOp* op, uint32_t executed){
+  this->emit({0x4C, 0x89, 0xE7});                 //mov rdi, r12
+  this->emit({0x48, 0xBE}); this->emit64(reinterpret_cast<uint64_t>(op));   //mov rsi, op
+  this->emit({0x48, 0xB8}); this->emit64(reinterpret_cast<uint64_t>(&JitCompiler::interpret_helper));
+  this->emit({0xFF, 0xD0});                       //call rax
+  this->emit({0x84, 0xC0});                       //test al, al
+  this->emit_exit_if_failed(executed);
+  if(executed == b->ops.size()) return;
+  this->emit({0x48, 0xB8}); this->emit64(reinterpret_cast<uint64_t>(&b->valid));
+  this->emit({0x80, 0x38, 0x00});                 //cmp byte [rax], 0
+  size_t still_valid = this->emit_jump({0x0F, 0x85});
+  this->emit_exit(executed);
+  this->patch_jump(still_valid);
+}
+
+//register to register operation, eax <= gpr[b] op gpr[c], gpr[a] <= eax
+void JitCompiler::emit_register_operation(uint8_t opcode, uint8_t a, uint8_t b, uint8_t c){
+  this->emit_load_register(EAX, b);
+  this->emit(opcode == 0xAF ? std::initializer_list<uint8_t>{0x0F, 0xAF} : std::initializer_list<uint8_t>{opcode});
+  this->emit({0x43, static_cast<uint8_t>(4 * c)});
+  this->emit_store_register(a, EAX);
+}
+
+void JitCompiler::emit_micro_op(const TranslatedBlock* b, size_t i){
+  const MicroOp& op = b->ops[i];
+  const DecodedInstruction& d = op.decoded;
+  uint32_t executed = static_cast<uint32_t>(i + 1);
+
+  //pc points to the next instruction while this one executes
+  this->emit({0xC7, 0x43, PC_OFFSET}); this->emit32(op.address + 4);
+
+  if(!this->is_native(b, i)){
+    this->emit_interpreter_call(b, &op, executed);
+    return;
+  }
+
+  if(d.macro == MacroOp::LOAD_LITERAL){ //gpr[A] <= literal, pc skips it
+    this->emit_count(CpuContext::EVENT_LOAD);
+    this->emit({0xB8}); this->emit32(d.literal);  //mov eax, literal
+    this->emit_store_register(d.a, EAX);
+    this->emit({0xC7, 0x43, PC_OFFSET}); this->emit32(op.address + 8);
+    return;
+  }
+
+  switch(d.opcode){
+    case 0x4: //XCHG
+      this->emit_load_register(EAX, d.b);
+      this->emit_load_register(ECX, d.c);
+      this->emit_store_register(d.b, ECX);
+      this->emit_store_register(d.c, EAX);
+      break;
+    case 0x5:{ //ADD, SUB, MUL
+      const uint8_t opcodes[] = {0x03, 0x2B, 0xAF};
+      this->emit_register_operation(opcodes[d.mode], d.a, d.b, d.c);
+      break;
+    }
+    case 0x6: //NOT, AND, OR, XOR
+      if(d.mode == 0x0){
+        this->emit_load_register(EAX, d.b);
+        this->emit({0xF7, 0xD0});                   //not eax
+        this->emit_store_register(d.a, EAX);
+      }
+      else{
+        const uint8_t opcodes[] = {0x00, 0x23, 0x0B, 0x33};
+        this->emit_register_operation(opcodes[d.mode], d.a, d.b, d.c);
+      }
+      break;
+    case 0x7: //SHL, SHR
+      this->emit_load_register(EAX, d.b);
+      this->emit_load_register(ECX, d.c);
+      this->emit({0xD3, static_cast<uint8_t>(d.mode == 0x0 ? 0xE0 : 0xE8)});   //shl/shr eax, cl
+      this->emit_store_register(d.a, EAX);
+      break;
+    case 0x8:
+      if(d.mode == 0x1){ //PUSH, gpr[A] <= gpr[A] + D; mem32[gpr[A]] <= gpr[C]
+        this->emit_load_register(EAX, d.a);
+        this->emit({0x05}); this->emit32(static_cast<uint32_t>(d.d));
+        this->emit_store_register(d.a, EAX);
+      }
+      else this->emit_effective_address(d.a, d.b, d.d);
+      this->emit_load_register(EDX, d.c);
+      this->emit_count(CpuContext::EVENT_STORE);
+      this->emit_memory_store(b, executed);
+      break;
+    case 0x9:
+      if(d.mode == 0x1){ //gpr[A] <= gpr[B] + D
+        this->emit_load_register(EAX, d.b);
+        this->emit({0x05}); this->emit32(static_cast<uint32_t>(d.d));
+        this->emit_store_register(d.a, EAX);
+      }
+      else if(d.mode == 0x3){ //POP, gpr[A] <= mem32[gpr[B]]; gpr[B] <= gpr[B] + D
+        this->emit_count(CpuContext::EVENT_LOAD);
+        this->emit_load_register(EAX, d.b);
+        this->emit_memory_load(executed);
+        this->emit_store_register(d.a, EAX);
+        this->emit_load_register(EAX, d.b);
+        this->emit({0x05}); this->emit32(static_cast<uint32_t>(d.d));
+        this->emit_store_register(d.b, EAX);
+      }
+      else{ //gpr[A] <= mem32[gpr[B] + gpr[C] + D]
+        this->emit_count(CpuContext::EVENT_LOAD);
+        this->emit_effective_address(d.b, d.c, d.d);
+        this->emit_memory_load(executed);
+        this->emit_store_register(d.a, EAX);
+      }
+      break;
+  }
+}
+
+NativeBlock JitCompiler::compile(TranslatedBlock* b){
+  if(!this->available) return nullptr;
+  //unknown instructions are left to the interpreter
+  for(size_t i = 0 ; i < b->ops.size() ; ++i){
+    if(!Emulator::is_implemented(b->ops[i].decoded.opcode, b->ops[i].decoded.mode)) return nullptr;
+    if(reads_counter(b->ops[i].decoded)) return nullptr;
+  }
+
+  this->code.clear();
+  this->emit_prologue();
+  for(size_t i = 0 ; i < b->ops.size() ; ++i) this->emit_micro_op(b, i);
+  this->emit_exit(static_cast<uint32_t>(b->ops.size()));
+
+  //arena is never reused, once it is full the remaining blocks stay interpreted
+  if(this->arena_used + this->code.size() > ARENA_SIZE) return nullptr;
+  uint8_t* native = this->arena + this->arena_used;
+  memcpy(native, this->code.data(), this->code.size());
+  this->arena_used += (this->code.size() + 15) & ~static_cast<size_t>(15);
+  ++this->compiled_blocks;
+  return reinterpret_cast<NativeBlock>(native);
+}
@@ -0,0 +1,20 @@
+//all of the emulator, built as libemu for programs that embed it
+#include "emulator.cpp"
+#include "interpreter.cpp"
+#include "jit.cpp"
+#include "trace.cpp"
+#include "traceWriter.cpp"
+#include "disassembler.cpp"
+#include "terminal.cpp"
+#include "timer.cpp"
+#include "semihost.cpp"
+#include "snapshot.cpp"
+#include "hexLoader.cpp"
+#include "mappedImage.cpp"
+#include "symbolMap.cpp"
+#include "profiler.cpp"
+#include "imageTemplate.cpp"
+#include "instanceScheduler.cpp"
+#include "batch.cpp"
+#include "eventLog.cpp"
+#include "debugger.cpp"
@@ -742,6 +742,74 @@ void Linker::print_hex(){
   }
 }
 
+//contiguous segments become one image segment, trailing zero bytes are left to zero fill
+void Linker::print_bin(uint32_t entry){
+  std::sort(this->global_segment_table->segments.begin(), this->global_segment_table->segments.end(), [this](const Segment* a, const Segment* b) {return compareSegmentsByAddress(a, b);});
+
+  vector<BinaryImageSegment> image_segments;
+  vector<vector<uint8_t>> payloads;
+  for(int i = 0 ; i < this->global_segment_table->segments.size() ; ++i){
+    Segment* segment = this->global_segment_table->segments.at(i);
+    ulong start_addr = segment->get_start_address();
+    if(image_segments.empty() || image_segments.back().load_address + payloads.back().size() != start_addr){
+      image_segments.push_back({static_cast<uint32_t>(start_addr), 0, 0, 0});
+      payloads.push_back(vector<uint8_t>());
+    }
+    for(int j = 0 ; j < segment->get_size() ; ++j){
+      payloads.back().push_back(static_cast<uint8_t>(segment->machine_code.at(j).to_ulong()));
+    }
+  }
+
+  const uint32_t page_size = BinaryImageFormat::PAGE_SIZE;
+  uint32_t file_offset = sizeof(BinaryImageHeader) + sizeof(BinaryImageSegment) * image_segments.size();
+  for(int i = 0 ; i < image_segments.size() ; ++i){
+    BinaryImageSegment& s = image_segments.at(i);
+    uint32_t size = payloads.at(i).size();
+    while(size > 0 && payloads.at(i).at(size - 1) == 0) --size;
+    s.file_size = size;
+    s.zero_fill_size = payloads.at(i).size() - size;
+    //next free file page, at the in-page offset of the load address
+    file_offset = ((file_offset + page_size - 1) & ~(page_size - 1)) + (s.load_address & (page_size - 1));
+    s.file_offset = file_offset;
+    file_offset += size;
+  }
+
+  BinaryImageHeader header = {};
+  memcpy(header.magic, BinaryImageFormat::MAGIC, strlen(BinaryImageFormat::MAGIC));
+  header.version = BinaryImageFormat::VERSION;
+  header.entry = entry;
+  header.segment_count = image_segments.size();
+
+  vector<uint8_t> image(file_offset, 0);
+  memcpy(image.data(), &header, sizeof(header));
+  if(!image_segments.empty()) memcpy(image.data() + sizeof(header), image_segments.data(), sizeof(BinaryImageSegment) * image_segments.size());
+  for(int i = 0 ; i < image_segments.size() ; ++i){
+    if(image_segments.at(i).file_size > 0) memcpy(image.data() + image_segments.at(i).file_offset, payloads.at(i).data(), image_segments.at(i).file_size);
+  }
+  //the last payload is padded to a whole page so its guest page can be mapped
+  image.resize((image.size() + page_size - 1) & ~(page_size - 1), 0);
+  this->output_file->write(reinterpret_cast<const char*>(image.data()), image.size());
+}
+
+//every defined symbol with its final address, sorted by address, used by the emulator profiler
+//one "0xADDRESS\tKIND\tNAME" line per symbol, KIND is section, global or local
+void Linker::print_symbol_map(ofstream* f){
+  vector<Symbol*> symbols;
+  for(int i = 0 ; i < this->global_symbol_table->get_size() ; ++i){
+    Symbol* symbol = this->global_symbol_table->get_symbol(i);
+    if(symbol->get_section() != nullptr) symbols.push_back(symbol);
+  }
+  std::stable_sort(symbols.begin(), symbols.end(), [](Symbol* a, Symbol* b) {return static_cast<uint32_t>(a->get_value()) < static_cast<uint32_t>(b->get_value());});
+
+  for(int i = 0 ; i < symbols.size() ; ++i){
+    Symbol* symbol = symbols.at(i);
+    string kind = symbol->isSection() ? "section" : symbol->get_binding() == Symbol::GLOBAL ? "global" : "local";
+    std::stringstream stream;
+    stream << "0x" << std::hex << std::setw(8) << std::setfill('0') << static_cast<uint32_t>(symbol->get_value());
+    *f << stream.str() << "\t" << kind << "\t" << symbol->get_name() << "\n";
+  }
+}
+
 void Linker::change_section_id_unique(){
   for(int i = 0 ; i < this->all_sections.size(); ++i){
     this->all_sections.at(i)->set_id(i);
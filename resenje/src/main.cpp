@@ -5,7 +5,7 @@
 //#include "../inc/assembler.hpp"
 #include "assembler.cpp"
 #include "linker.cpp"
-#include "emulator.cpp"
+#include "libemu.cpp"
 
 int main(int argc, const char** argv){
 
@@ -77,8 +77,8 @@ int main(int argc, const char** argv){
     
     //EMULATION
 
-    ifstream* e = new ifstream("aplication.hex");
-    Emulator* emulator = new Emulator(e);
+    Emulator* emulator = new Emulator("aplication.hex");
+    emulator->run();
     delete emulator;
     
   }
@@ -1,18 +1,115 @@
-#include "emulator.cpp"
+#include "libemu.cpp"
 
 int main(int argc, const char** argv) {
 
 try
 {
-  if (argc != 2) throw new ExceptionAlert("Insufficient assembler arguments.");
-  
-  std::string filename = argv[1];
+  // emulator [--core=threaded|block|jit] [--trace[=text|binary]] [--frequency=MHz] [--realtime] [--no-idle-skip] [--mips] [--repeat=N]
+  //          [--snapshot-at=N|pc:ADDR] [--snapshot-file=F] [--profile[=program.map]] [--harts=N]
+  //          [--record=input.log|--replay=input.log] [--debug[=commands.txt]]
+  //          program.hex|program.bin
+  // emulator --restore [options] [emulator.snap]
+  // emulator --batch jobs.txt [-j N] [--quantum=N] [options]
+  EmulatorOptions options;
+  std::string filename = "";
+  std::string jobs_file = "";
+  uint threads = std::thread::hardware_concurrency();
+  uint64_t quantum = 0;
 
-  if(filename.find(".hex") == std::string::npos) throw new ExceptionAlert("Unsupported input filetype.");
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if(arg == "--core=threaded") options.core = EmulatorOptions::THREADED;
+    else if(arg == "--core=block") options.core = EmulatorOptions::BLOCK;
+    else if(arg == "--core=jit") options.core = EmulatorOptions::JIT;
+    else if(arg == "--trace" || arg == "--trace=text") options.trace = EmulatorOptions::TRACE_TEXT;
+    else if(arg == "--trace=binary") options.trace = EmulatorOptions::TRACE_BINARY;
+    else if(arg.find("--frequency=") == 0) options.frequency_mhz = std::stoul(arg.substr(12), nullptr, 0);
+    else if(arg == "--realtime") options.realtime = true;
+    else if(arg == "--no-idle-skip") options.skip_idle = false;
+    else if(arg.find("--snapshot-at=pc:") == 0){
+      options.snapshot = EmulatorOptions::SNAPSHOT_AT_PC;
+      options.snapshot_at = std::stoul(arg.substr(17), nullptr, 0);
+    }
+    else if(arg.find("--snapshot-at=") == 0){
+      options.snapshot = EmulatorOptions::SNAPSHOT_AT_COUNT;
+      options.snapshot_at = std::stoull(arg.substr(14), nullptr, 0);
+    }
+    else if(arg.find("--snapshot-file=") == 0) options.snapshot_file = arg.substr(16);
+    else if(arg == "--restore") options.restore = true;
+    else if(arg == "--profile") options.profile = true;
+    else if(arg.find("--profile=") == 0){
+      options.profile = true;
+      options.symbol_file = arg.substr(10);
+    }
+    else if(arg.find("--harts=") == 0) options.harts = std::stoul(arg.substr(8), nullptr, 0);
+    else if(arg.find("--record=") == 0) options.record_file = arg.substr(9);
+    else if(arg.find("--replay=") == 0) options.replay_file = arg.substr(9);
+    else if(arg == "--debug") options.debug = true;
+    else if(arg.find("--debug=") == 0){
+      options.debug = true;
+      options.debug_script = arg.substr(8);
+    }
+    else if(arg == "--mips") options.measure = true;
+    else if(arg.find("--repeat=") == 0) options.repeat = std::stoul(arg.substr(9), nullptr, 0);
+    else if(arg == "--batch"){
+      if(i + 1 == argc) throw ExceptionAlert("--batch needs a jobs file.");
+      jobs_file = argv[++i];
+    }
+    else if(arg == "-j"){
+      if(i + 1 == argc) throw ExceptionAlert("-j needs a number of threads.");
+      threads = std::stoul(argv[++i], nullptr, 0);
+    }
+    else if(arg.find("--quantum=") == 0){
+      quantum = std::stoull(arg.substr(10), nullptr, 0);
+      if(quantum == 0) throw ExceptionAlert("--quantum must be at least one instruction.");
+    }
+    else if(arg.find("-j") == 0) threads = std::stoul(arg.substr(2), nullptr, 0);
+    else if(arg.find("--") == 0) throw ExceptionAlert("Unknown emulator option " + arg + ".");
+    else if(filename == "") filename = arg;
+    else throw ExceptionAlert("Only one input file can be emulated.");
+  }
+
+  if(options.profile && options.trace != EmulatorOptions::TRACE_NONE) throw ExceptionAlert("--profile can not be combined with --trace.");
+  if(options.debug && (options.profile || options.trace != EmulatorOptions::TRACE_NONE)) throw ExceptionAlert("--debug can not be combined with --trace or --profile.");
+  if(options.harts > 1 && options.debug) throw ExceptionAlert("The debugger supports only one hart.");
+  if(options.record_file != "" && options.replay_file != "") throw ExceptionAlert("--record can not be combined with --replay.");
+  if(options.harts > 1 && (options.record_file != "" || options.replay_file != "")) throw ExceptionAlert("Input can be recorded and replayed only with one hart.");
+  if(options.harts > 1 && (options.trace != EmulatorOptions::TRACE_NONE || options.profile || options.restore || options.snapshot != EmulatorOptions::SNAPSHOT_NONE)){
+    throw ExceptionAlert("Tracing, profiling and snapshots are supported only with one hart.");
+  }
+
+  //every job is its own instance, nothing of it is written to files or the host terminal
+  if(jobs_file != ""){
+    if(filename != "") throw ExceptionAlert("Images of a batch are named in its jobs file.");
+    if(options.trace != EmulatorOptions::TRACE_NONE || options.profile || options.restore || options.snapshot != EmulatorOptions::SNAPSHOT_NONE
+       || options.record_file != "" || options.replay_file != "" || options.debug){
+      throw ExceptionAlert("Tracing, profiling, snapshots, input logs and the debugger can not be combined with --batch.");
+    }
+    BatchRunner batch(jobs_file, options, threads, quantum);
+    batch.run();
+    return batch.get_failed_count() == 0 ? 0 : 1;
+  }
+
+  if(quantum != 0) throw ExceptionAlert("--quantum time-slices the jobs of a batch, it needs --batch.");
+
+  //a restored snapshot takes the place of the hex image
+  if(options.restore){
+    if(filename == "") filename = options.snapshot_file;
+    if(options.snapshot != EmulatorOptions::SNAPSHOT_NONE) throw ExceptionAlert("Snapshots can not be taken while restoring one.");
+    Emulator emulator(filename, options);
+    emulator.run();
+    return emulator.get_exit_code();
+  }
+
+  if (filename == "") throw ExceptionAlert("Insufficient emulator arguments.");
 
-  ifstream* file = new ifstream(filename);
+  if(filename.find(".hex") == std::string::npos && filename.find(".bin") == std::string::npos) throw ExceptionAlert("Unsupported input filetype.");
 
-  Emulator emulator = Emulator(file);
+  Emulator emulator(filename, options);
+  emulator.run();
+  //a guest that exits through semihosting chooses the exit code
+  return emulator.get_exit_code();
 }
   catch(ExceptionAlert& e) {
     std::cout<<e.get_message()<<std::endl;
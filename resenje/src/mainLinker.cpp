@@ -8,7 +8,9 @@ int main(int argc, const char** argv) {
     unordered_map<string, uint32_t> place_arguments = unordered_map<string, uint32_t>();
     vector<ifstream*> input_files;
     ofstream* output_file;
-    bool hexFound = false, oFound = false;
+    ofstream* map_file = nullptr;
+    bool hexFound = false, binFound = false, oFound = false;
+    uint32_t entry = BinaryImageFormat::DEFAULT_ENTRY;
     //skip filename
     for (int i = 1; i < argc; ++i) 
     {
@@ -19,6 +21,26 @@ int main(int argc, const char** argv) {
         hexFound = true;
       }
 
+      // -BIN
+      else if (std::string(argv[i]) == "-bin") 
+      {
+        if(binFound) throw ExceptionAlert("-bin command specified twice.");
+        binFound = true;
+      }
+
+      // -ENTRY
+      else if (std::string(argv[i]).find("-entry=") == 0) 
+      {
+        entry = static_cast<uint32_t>(std::stoul(std::string(argv[i]).substr(7), nullptr, 0));
+      }
+
+      // -MAP
+      else if (std::string(argv[i]).find("-map=") == 0) 
+      {
+        if(map_file != nullptr) throw ExceptionAlert("-map command specified twice.");
+        map_file = new ofstream(std::string(argv[i]).substr(5));
+      }
+
       // -PLACE
       else if (std::string(argv[i]).find("-place") != std::string::npos) 
       {
@@ -46,7 +68,7 @@ int main(int argc, const char** argv) {
           oFound = true;
           std::string outputFileName = argv[i + 1];
           ++i;
-          output_file = new ofstream(outputFileName);
+          output_file = new ofstream(outputFileName, std::ios::binary);
         } 
         else throw  ExceptionAlert("Unsupported output filetype.");
       }
@@ -59,8 +81,14 @@ int main(int argc, const char** argv) {
         input_files.push_back(input_file);
       }
     }
+    if(hexFound && binFound) throw ExceptionAlert("Only one of -hex and -bin can be specified.");
     Linker linker = Linker(input_files, output_file, place_arguments);
-    linker.print_hex();
+    if(binFound) linker.print_bin(entry);
+    else linker.print_hex();
+    if(map_file != nullptr){
+      linker.print_symbol_map(map_file);
+      map_file->close();
+    }
     output_file->close();
   }
   catch(ExceptionAlert& e) {
@@ -0,0 +1,40 @@
+#include "traceDump.cpp"
+#include "disassembler.cpp"
+
+int main(int argc, const char** argv) {
+
+try
+{
+  // tracedump [--registers] [-o output.txt] emulation.trace
+  bool registers = false;
+  std::string filename = "";
+  std::string output_filename = "";
+
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if(arg == "--registers") registers = true;
+    else if(arg == "-o"){
+      if(i + 1 >= argc) throw ExceptionAlert("Output file not specified.");
+      output_filename = argv[++i];
+    }
+    else if(arg.find("-") == 0) throw ExceptionAlert("Unknown tracedump option " + arg + ".");
+    else if(filename == "") filename = arg;
+    else throw ExceptionAlert("Only one trace file can be dumped.");
+  }
+
+  if (filename == "") throw ExceptionAlert("Insufficient tracedump arguments.");
+
+  if(output_filename == ""){
+    TraceDump dump = TraceDump(filename, &std::cout, registers);
+  }
+  else{
+    ofstream output(output_filename);
+    TraceDump dump = TraceDump(filename, &output, registers);
+  }
+}
+  catch(ExceptionAlert& e) {
+    std::cout<<e.get_message()<<std::endl;
+  }
+  return 0;
+}
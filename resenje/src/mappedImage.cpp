@@ -0,0 +1,88 @@
+#include "../inc/mappedImage.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedImage::MappedImage(const string& filename){
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0) throw ExceptionAlert("Input file " + filename + " can not be opened.");
+  try{
+    this->map(fd, filename);
+  }
+  catch(ExceptionAlert& e){
+    close(fd);
+    throw;
+  }
+  close(fd);
+}
+
+MappedImage::MappedImage(int fd, const string& filename){
+  this->map(fd, filename);
+}
+
+void MappedImage::map(int fd, const string& filename){
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(BinaryImageHeader)){
+    throw ExceptionAlert("Input file " + filename + " is not a binary image.");
+  }
+  this->mapping_size = st.st_size;
+  void* mapping = mmap(nullptr, this->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if(mapping == MAP_FAILED) throw ExceptionAlert("Input file " + filename + " can not be mapped.");
+  this->mapping = static_cast<uint8_t*>(mapping);
+  this->header = reinterpret_cast<const BinaryImageHeader*>(this->mapping);
+  this->segments = reinterpret_cast<const BinaryImageSegment*>(this->mapping + sizeof(BinaryImageHeader));
+
+  string error = "";
+  if(memcmp(this->header->magic, BinaryImageFormat::MAGIC, strlen(BinaryImageFormat::MAGIC)) != 0 || this->header->version != BinaryImageFormat::VERSION){
+    error = "Input file " + filename + " is not a binary image of this version.";
+  }
+  else if(sizeof(BinaryImageHeader) + sizeof(BinaryImageSegment) * size_t(this->header->segment_count) > this->mapping_size){
+    error = "Input file " + filename + " is truncated.";
+  }
+  for(uint32_t i = 0 ; error.empty() && i < this->header->segment_count ; ++i){
+    if(size_t(this->segments[i].file_offset) + this->segments[i].file_size > this->mapping_size) error = "Input file " + filename + " is truncated.";
+  }
+  if(!error.empty()){
+    munmap(this->mapping, this->mapping_size);
+    throw ExceptionAlert(error);
+  }
+}
+
+MappedImage::~MappedImage(){
+  munmap(this->mapping, this->mapping_size);
+}
+
+//a guest page is mapped when its whole file page lies inside the file and the page is still free,
+//otherwise the segment's bytes are copied (pages shared with another segment or with device registers)
+void MappedImage::map_into(Memory* m){
+  const uint32_t page_size = Memory::PAGE_SIZE;
+  for(uint32_t i = 0 ; i < this->header->segment_count ; ++i){
+    const BinaryImageSegment& s = this->segments[i];
+    uint64_t address = s.load_address;
+    uint64_t end = uint64_t(s.load_address) + s.file_size;
+    while(address < end){
+      uint32_t offset = address & Memory::PAGE_MASK;
+      uint32_t n = std::min<uint64_t>(end - address, page_size - offset);
+      size_t file_position = s.file_offset + (address - s.load_address);
+      size_t file_page = file_position - offset;
+      if(!m->is_mapped(address) && file_page + page_size <= this->mapping_size){
+        m->map_host_page(address >> Memory::PAGE_BITS, this->mapping + file_page);
+      }
+      else m->write_bytes(address, this->mapping + file_position, n);
+      address += n;
+    }
+    //the zero fill only has to clear what was loaded there before, untouched pages read as 0 already
+    static const uint8_t zeros[Memory::PAGE_SIZE] = {};
+    uint8_t bytes[Memory::PAGE_SIZE];
+    end += s.zero_fill_size;
+    while(address < end){
+      uint32_t n = std::min<uint64_t>(end - address, page_size - (address & Memory::PAGE_MASK));
+      if(m->is_mapped(address)){
+        m->read_bytes(address, bytes, n);
+        if(memcmp(bytes, zeros, n) != 0) m->write_bytes(address, zeros, n);
+      }
+      address += n;
+    }
+  }
+}
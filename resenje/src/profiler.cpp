@@ -0,0 +1,87 @@
+#include "../inc/profiler.hpp"
+#include "../inc/disassembler.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+Profiler::Profiler(){
+  this->counter_pages = static_cast<uint64_t**>(calloc(Memory::PAGE_COUNT, sizeof(uint64_t*)));
+  if(this->counter_pages == nullptr) throw ExceptionAlert("Out of host memory while allocating the profiler.");
+}
+
+Profiler::~Profiler(){
+  for(size_t i = 0 ; i < this->counted_page_numbers.size() ; ++i){
+    free(this->counter_pages[this->counted_page_numbers[i]]);
+  }
+  free(this->counter_pages);
+}
+
+uint64_t* Profiler::allocate_page(uint32_t a){
+  uint64_t* page = static_cast<uint64_t*>(calloc(COUNTERS_PER_PAGE, sizeof(uint64_t)));
+  if(page == nullptr) throw ExceptionAlert("Out of host memory while allocating the profiler.");
+  this->counter_pages[a >> Memory::PAGE_BITS] = page;
+  this->counted_page_numbers.push_back(a >> Memory::PAGE_BITS);
+  return page;
+}
+
+static void print_share(ostream& out, uint64_t count, uint64_t total){
+  out << std::setw(14) << count << std::setw(8) << std::fixed << std::setprecision(2) << (total > 0 ? 100.0 * count / total : 0.0) << "%  ";
+}
+
+void Profiler::report(ostream& out, const SymbolMap* symbols, Memory* memory) const {
+  vector<pair<uint64_t, uint32_t>> addresses;   //(count, pc) of every pc that retired at least once
+  uint64_t total = 0;
+  for(size_t i = 0 ; i < this->counted_page_numbers.size() ; ++i){
+    uint32_t page_number = this->counted_page_numbers[i];
+    const uint64_t* page = this->counter_pages[page_number];
+    for(uint32_t j = 0 ; j < COUNTERS_PER_PAGE ; ++j){
+      if(page[j] == 0) continue;
+      addresses.push_back({page[j], (page_number << Memory::PAGE_BITS) | (j << 2)});
+      total += page[j];
+    }
+  }
+  //hottest first, ties in address order
+  std::sort(addresses.begin(), addresses.end(), [](const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b) {
+    return a.first != b.first ? a.first > b.first : a.second < b.second;
+  });
+
+  out << "PROFILE\n\n" << total << " instructions retired at " << addresses.size() << " addresses\n";
+
+  if(symbols != nullptr){
+    //routines keyed by their symbol, counts summed over every address they contain
+    std::map<const MappedSymbol*, uint64_t> routine_counts;
+    uint64_t unknown = 0;
+    for(size_t i = 0 ; i < addresses.size() ; ++i){
+      const MappedSymbol* routine = symbols->find_routine(addresses[i].second);
+      if(routine == nullptr) unknown += addresses[i].first;
+      else routine_counts[routine] += addresses[i].first;
+    }
+    vector<pair<uint64_t, const MappedSymbol*>> routines;
+    for(auto it = routine_counts.begin() ; it != routine_counts.end() ; ++it) routines.push_back({it->second, it->first});
+    std::sort(routines.begin(), routines.end(), [](const pair<uint64_t, const MappedSymbol*>& a, const pair<uint64_t, const MappedSymbol*>& b) {
+      return a.first != b.first ? a.first > b.first : a.second->address < b.second->address;
+    });
+
+    out << "\nHOTTEST ROUTINES\n\n" << std::setw(14) << "INSTRUCTIONS" << std::setw(9) << "SHARE" << "  ROUTINE\n";
+    for(size_t i = 0 ; i < routines.size() && i < REPORT_ROWS ; ++i){
+      print_share(out, routines[i].first, total);
+      out << routines[i].second->name << " (0x" << std::hex << routines[i].second->address << std::dec << ")\n";
+    }
+    if(unknown > 0){
+      print_share(out, unknown, total);
+      out << "<no symbol>\n";
+    }
+  }
+
+  out << "\nHOTTEST ADDRESSES\n\n" << std::setw(14) << "INSTRUCTIONS" << std::setw(9) << "SHARE" << "  ADDRESS     ";
+  if(symbols != nullptr) out << std::left << std::setw(24) << "LOCATION" << std::right;
+  out << "INSTRUCTION\n";
+  for(size_t i = 0 ; i < addresses.size() && i < REPORT_ROWS ; ++i){
+    uint32_t a = addresses[i].second;
+    print_share(out, addresses[i].first, total);
+    out << "0x" << std::hex << std::setw(8) << std::setfill('0') << a << std::setfill(' ') << std::dec << "  ";
+    if(symbols != nullptr) out << std::left << std::setw(24) << symbols->describe(a) << std::right;
+    out << describe_instruction(DecodedInstruction::decode(memory->read_word(a))) << "\n";
+  }
+  out << "\nEND_PROFILE\n";
+}
@@ -0,0 +1,116 @@
+#include "../inc/semihost.hpp"
+#include <vector>
+
+Semihost::Semihost(Memory* m, Terminal* t, uint64_t* next_event, bool host_files){
+  this->memory = m;
+  this->terminal = t;
+  this->next_event = next_event;
+  this->host_files = host_files;
+  this->memory->map_device(SH_CMD, REGISTERS_SIZE, this);
+  this->reset();
+}
+
+Semihost::~Semihost(){
+  this->close_files();
+}
+
+void Semihost::close_files(){
+  for(auto it = this->files.begin() ; it != this->files.end() ; ++it) fclose(it->second);
+  this->files.clear();
+}
+
+void Semihost::reset(){
+  for(uint32_t a = SH_CMD ; a < SH_CMD + REGISTERS_SIZE ; a += 4) this->memory->write_word(a, 0);
+  this->close_files();
+  this->exited.store(false, std::memory_order_relaxed);
+  this->exit_code = 0;
+}
+
+bool Semihost::read_name(string& name){
+  uint32_t a = this->memory->read_word(SH_NAME);
+  name.clear();
+  for(uint32_t i = 0 ; i < MAX_NAME ; ++i){
+    char c = static_cast<char>(this->memory->read_byte(a + i));
+    if(c == 0) return !name.empty();
+    name.push_back(c);
+  }
+  return false;
+}
+
+//guest buffer to the terminal when file is nullptr
+uint32_t Semihost::write(FILE* file){
+  uint32_t a = this->memory->read_word(SH_ADDR);
+  uint32_t length = this->memory->read_word(SH_LEN);
+  vector<uint8_t> chunk(std::min(length, CHUNK_SIZE));
+  for(uint32_t done = 0 ; done < length ; ){
+    uint32_t n = std::min(length - done, CHUNK_SIZE);
+    this->memory->read_bytes(a + done, chunk.data(), n);
+    if(file == nullptr) this->terminal->print(chunk.data(), n);
+    else if(fwrite(chunk.data(), 1, n, file) != n) return ERROR;
+    done += n;
+  }
+  return length;
+}
+
+uint32_t Semihost::read_file(FILE* file, uint32_t offset){
+  uint32_t a = this->memory->read_word(SH_ADDR);
+  uint32_t length = this->memory->read_word(SH_LEN);
+  if(fseek(file, offset, SEEK_SET) != 0) return ERROR;
+  vector<uint8_t> chunk(std::min(length, CHUNK_SIZE));
+  uint32_t done = 0;
+  while(done < length){
+    size_t n = fread(chunk.data(), 1, std::min(length - done, CHUNK_SIZE), file);
+    if(n == 0) break;
+    //stores into code pages drop the translations made from them, as any guest store does
+    this->memory->write_bytes(a + done, chunk.data(), n);
+    done += n;
+  }
+  return ferror(file) ? ERROR : done;
+}
+
+uint32_t Semihost::execute(uint32_t command){
+  string name;
+  switch(command){
+    case WRITE:
+      return this->write(nullptr);
+    case WRITE_FILE:{
+      if(!this->host_files || !this->read_name(name)) return ERROR;
+      auto it = this->files.find(name);
+      if(it == this->files.end()){
+        FILE* file = fopen(name.c_str(), "wb");
+        if(file == nullptr) return ERROR;
+        it = this->files.emplace(name, file).first;
+      }
+      return this->write(it->second);
+    }
+    case READ_FILE:{
+      if(!this->host_files || !this->read_name(name)) return ERROR;
+      //a file written in this run is flushed first, so the guest reads back what it wrote
+      auto it = this->files.find(name);
+      if(it != this->files.end()) fflush(it->second);
+      FILE* file = fopen(name.c_str(), "rb");
+      if(file == nullptr) return ERROR;
+      uint32_t result = this->read_file(file, this->memory->read_word(SH_ARG));
+      fclose(file);
+      return result;
+    }
+    case EXIT:
+      this->exit_code = this->memory->read_word(SH_ARG);
+      this->exited.store(true, std::memory_order_release);
+      //may run on another hart's thread, like the other requests to hart 0
+      __atomic_store_n(this->next_event, 0, __ATOMIC_RELAXED);
+      return 0;
+    default:
+      return ERROR;
+  }
+}
+
+//the registers are written back from here, writing 0 into sh_cmd comes back as a write that does nothing
+void Semihost::mmio_written(uint32_t address, uint32_t size){
+  if(address >= SH_CMD + 4 || address + size <= SH_CMD) return;
+  uint32_t command = this->memory->read_word(SH_CMD);
+  if(command == NONE) return;
+  uint32_t result = this->execute(command);
+  this->memory->write_word(SH_RESULT, result);
+  this->memory->write_word(SH_CMD, NONE);
+}
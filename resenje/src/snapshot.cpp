@@ -0,0 +1,75 @@
+#include "../inc/snapshot.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+size_t Snapshot::pages_offset(uint32_t page_count){
+  size_t size = sizeof(SnapshotHeader) + sizeof(uint32_t) * page_count;
+  return (size + Memory::PAGE_SIZE - 1) & ~size_t(Memory::PAGE_MASK);
+}
+
+void Snapshot::save(const string& filename, const SnapshotHeader& header, const Memory* m){
+  vector<uint32_t> page_numbers = m->get_mapped_pages();
+  std::sort(page_numbers.begin(), page_numbers.end());
+
+  SnapshotHeader h = header;
+  memcpy(h.magic, MAGIC, sizeof(h.magic));
+  h.version = VERSION;
+  h.page_count = page_numbers.size();
+
+  vector<uint8_t> head(pages_offset(h.page_count), 0);
+  memcpy(head.data(), &h, sizeof(h));
+  memcpy(head.data() + sizeof(h), page_numbers.data(), sizeof(uint32_t) * h.page_count);
+
+  FILE* file = fopen(filename.c_str(), "wb");
+  if(file == nullptr) throw ExceptionAlert("Snapshot file " + filename + " can not be created.");
+  bool ok = fwrite(head.data(), 1, head.size(), file) == head.size();
+  for(size_t i = 0 ; ok && i < page_numbers.size() ; ++i){
+    ok = fwrite(m->get_page_table()[page_numbers[i]], 1, Memory::PAGE_SIZE, file) == Memory::PAGE_SIZE;
+  }
+  if(fclose(file) != 0 || !ok) throw ExceptionAlert("Snapshot file " + filename + " can not be written.");
+}
+
+Snapshot::Snapshot(const string& filename){
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0) throw ExceptionAlert("Snapshot file " + filename + " can not be opened.");
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SnapshotHeader)){
+    close(fd);
+    throw ExceptionAlert("Snapshot file " + filename + " is too short.");
+  }
+  this->mapping_size = st.st_size;
+  //private and writable, guest writes never reach the file
+  void* mapping = mmap(nullptr, this->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) throw ExceptionAlert("Snapshot file " + filename + " can not be mapped.");
+  this->mapping = static_cast<uint8_t*>(mapping);
+  this->header = reinterpret_cast<const SnapshotHeader*>(this->mapping);
+
+  if(memcmp(this->header->magic, MAGIC, sizeof(this->header->magic)) != 0 || this->header->version != VERSION){
+    munmap(this->mapping, this->mapping_size);
+    throw ExceptionAlert(filename + " is not a snapshot of this emulator version.");
+  }
+  if(pages_offset(this->header->page_count) + size_t(this->header->page_count) * Memory::PAGE_SIZE > this->mapping_size){
+    munmap(this->mapping, this->mapping_size);
+    throw ExceptionAlert("Snapshot file " + filename + " is truncated.");
+  }
+}
+
+Snapshot::~Snapshot(){
+  munmap(this->mapping, this->mapping_size);
+}
+
+void Snapshot::map_into(Memory* m){
+  const uint32_t* page_numbers = reinterpret_cast<const uint32_t*>(this->mapping + sizeof(SnapshotHeader));
+  uint8_t* pages = this->mapping + pages_offset(this->header->page_count);
+  for(uint32_t i = 0 ; i < this->header->page_count ; ++i){
+    uint8_t* page = pages + size_t(i) * Memory::PAGE_SIZE;
+    uint32_t address = page_numbers[i] << Memory::PAGE_BITS;
+    //pages the devices already allocated for their registers are copied
+    if(m->is_mapped(address)) memcpy(m->get_page(address), page, Memory::PAGE_SIZE);
+    else m->map_host_page(page_numbers[i], page);
+  }
+}
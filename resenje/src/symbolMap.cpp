@@ -0,0 +1,63 @@
+#include "../inc/symbolMap.hpp"
+#include "../inc/exceptionAlert.hpp"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+SymbolMap::SymbolMap(const string& filename){
+  ifstream file(filename);
+  if(!file.is_open()) throw ExceptionAlert("Symbol map " + filename + " can not be opened.");
+  string line;
+  while(std::getline(file, line)){
+    if(line.empty()) continue;
+    std::istringstream fields(line);
+    string address, kind, name;
+    if(!(fields >> address >> kind >> name)) throw ExceptionAlert("Symbol map " + filename + " has a malformed line: " + line);
+    MappedSymbol symbol;
+    symbol.address = static_cast<uint32_t>(std::stoul(address, nullptr, 0));
+    if(kind == "section") symbol.kind = MappedSymbol::SECTION;
+    else if(kind == "global") symbol.kind = MappedSymbol::GLOBAL;
+    else if(kind == "local") symbol.kind = MappedSymbol::LOCAL;
+    else throw ExceptionAlert("Symbol map " + filename + " has an unknown symbol kind " + kind + ".");
+    symbol.name = name;
+    this->symbols.push_back(symbol);
+  }
+  //the linker writes them sorted, a hand written map may not be
+  std::stable_sort(this->symbols.begin(), this->symbols.end(), [](const MappedSymbol& a, const MappedSymbol& b) {return a.address < b.address;});
+}
+
+template<class Filter>
+const MappedSymbol* SymbolMap::find_below(uint32_t a, Filter accept) const {
+  auto it = std::upper_bound(this->symbols.begin(), this->symbols.end(), a, [](uint32_t v, const MappedSymbol& s) {return v < s.address;});
+  while(it != this->symbols.begin()){
+    --it;
+    if(accept(*it)) return &*it;
+  }
+  return nullptr;
+}
+
+//a section symbol is only used when nothing else starts at the same address
+const MappedSymbol* SymbolMap::find_symbol(uint32_t a) const {
+  const MappedSymbol* named = this->find_below(a, [](const MappedSymbol& s) {return s.kind != MappedSymbol::SECTION;});
+  const MappedSymbol* section = this->find_below(a, [](const MappedSymbol& s) {return s.kind == MappedSymbol::SECTION;});
+  if(named == nullptr || (section != nullptr && section->address > named->address)) return section;
+  return named;
+}
+
+const MappedSymbol* SymbolMap::find_routine(uint32_t a) const {
+  const MappedSymbol* global = this->find_below(a, [](const MappedSymbol& s) {return s.kind == MappedSymbol::GLOBAL;});
+  const MappedSymbol* section = this->find_below(a, [](const MappedSymbol& s) {return s.kind == MappedSymbol::SECTION;});
+  if(global == nullptr || (section != nullptr && section->address > global->address)) return section;
+  return global;
+}
+
+string SymbolMap::describe(uint32_t a) const {
+  std::stringstream stream;
+  const MappedSymbol* symbol = this->find_symbol(a);
+  if(symbol == nullptr) stream << "0x" << std::hex << a;
+  else{
+    stream << symbol->name;
+    if(a != symbol->address) stream << "+0x" << std::hex << (a - symbol->address);
+  }
+  return stream.str();
+}
@@ -0,0 +1,132 @@
+#include "../inc/terminal.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+//the host terminal is switched to non canonical mode without echo so every key reaches the guest at once
+//settings are restored at exit, also when emulation ends with an exception
+static struct termios saved_termios;
+static bool termios_changed = false;
+
+static void restore_termios(){
+  if(termios_changed) tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+  termios_changed = false;
+}
+
+static void enter_raw_mode(){
+  if(termios_changed || !isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_termios) != 0) return;
+  struct termios raw = saved_termios;
+  raw.c_lflag &= ~(ICANON | ECHO);
+  raw.c_cc[VMIN] = 1;
+  raw.c_cc[VTIME] = 0;
+  if(tcsetattr(STDIN_FILENO, TCSANOW, &raw) != 0) return;
+  termios_changed = true;
+  static bool registered = false;
+  if(!registered) atexit(restore_termios);
+  registered = true;
+}
+
+Terminal::Terminal(Memory* m, Mode mode) : input(INPUT_RING_BITS), output(OUTPUT_RING_BITS){
+  this->memory = m;
+  this->mode = mode;
+  this->memory->map_device(TERM_OUT, REGISTERS_SIZE, this);
+  this->stopping.store(false);
+  this->queued_position = 0;
+  if(mode == DETACHED) return;
+  if(mode == INTERACTIVE) enter_raw_mode();
+  this->io = std::thread(&Terminal::run_io, this);
+}
+
+Terminal::~Terminal(){
+  if(this->mode == DETACHED) return;
+  this->stopping.store(true, std::memory_order_release);
+  this->io.join();
+  restore_termios();
+}
+
+void Terminal::write_output(){
+  const uint8_t* bytes;
+  size_t n;
+  while((n = this->output.peek(&bytes)) > 0){
+    ssize_t written = write(STDOUT_FILENO, bytes, n);
+    if(written <= 0) written = n;   //output is gone, nothing can be done about it
+    this->output.consume(written);
+  }
+}
+
+//I/O thread, waits for stdin with a timeout so output is also written at least every POLL_INTERVAL_MS
+void Terminal::run_io(){
+  bool input_open = this->mode == INTERACTIVE;
+  while(true){
+    bool last = this->stopping.load(std::memory_order_acquire);
+    this->write_output();
+    if(last) break;
+
+    if(!input_open){
+      std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+      continue;
+    }
+    struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+    if(poll(&fd, 1, POLL_INTERVAL_MS) <= 0) continue;
+    uint8_t bytes[64];
+    ssize_t n = read(STDIN_FILENO, bytes, sizeof(bytes));
+    if(n <= 0){
+      input_open = false;
+      continue;
+    }
+    //waits for the guest if it is not taking input, keys are never dropped
+    while(!this->input.try_write(bytes, n) && !this->stopping.load(std::memory_order_relaxed)){
+      this->write_output();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+uint8_t Terminal::receive(){
+  if(this->mode == DETACHED){
+    if(this->queued_position == this->queued.size()) return 0;
+    uint8_t character = static_cast<uint8_t>(this->queued[this->queued_position++]);
+    this->deliver(character);
+    return character;
+  }
+  const uint8_t* bytes;
+  if(this->input.peek(&bytes) == 0) return 0;
+  uint8_t character = *bytes;
+  this->deliver(character);
+  this->input.consume(1);
+  return character;
+}
+
+void Terminal::deliver(uint8_t character){
+  this->memory->write_word(TERM_IN, character);
+}
+
+void Terminal::send(const std::string& text){
+  if(this->mode != DETACHED) throw ExceptionAlert("Input can be sent only to a detached terminal.");
+  //characters already received are dropped so the queue does not grow with a long session
+  this->queued.erase(0, this->queued_position);
+  this->queued_position = 0;
+  this->queued += text;
+}
+
+void Terminal::flush(){
+  while(!this->output.empty()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+//larger outputs go through the ring in pieces that fit into it
+void Terminal::print(const uint8_t* bytes, size_t n){
+  if(this->mode == DETACHED){
+    this->captured.append(reinterpret_cast<const char*>(bytes), n);
+    return;
+  }
+  const size_t piece = size_t(1) << (OUTPUT_RING_BITS - 1);
+  for(size_t done = 0 ; done < n ; done += piece) this->output.write(bytes + done, std::min(piece, n - done));
+}
+
+void Terminal::mmio_written(uint32_t address, uint32_t size){
+  if(address >= TERM_OUT + 4 || address + size <= TERM_OUT) return;
+  uint8_t character = static_cast<uint8_t>(this->memory->read_word(TERM_OUT));
+  this->print(&character, 1);
+}
@@ -0,0 +1,63 @@
+#include "../inc/timer.hpp"
+#include <thread>
+
+const uint32_t Timer::PERIODS_MS[8] = {500, 1000, 1500, 2000, 5000, 10000, 30000, 60000};
+
+Timer::Timer(Memory* m, uint32_t frequency_mhz, bool realtime, const uint64_t* clock, uint64_t* next_event){
+  if(frequency_mhz == 0) throw ExceptionAlert("Emulated processor frequency must be at least 1 MHz.");
+  this->memory = m;
+  this->instructions_per_ms = uint64_t(frequency_mhz) * 1000;
+  this->realtime = realtime;
+  this->clock = clock;
+  this->next_event = next_event;
+  this->written = false;
+  this->memory->map_device(TIM_CFG, REGISTERS_SIZE, this);
+  this->reset();
+}
+
+void Timer::configure(uint32_t cfg){
+  this->period = PERIODS_MS[cfg & 0x7] * this->instructions_per_ms;
+  this->deadline = *this->clock + this->period;
+}
+
+//the caller schedules the next event afterwards
+void Timer::reset(){
+  this->written = false;
+  this->memory->write_word(TIM_CFG, 0);
+  this->configure(0);
+  this->start_clock = *this->clock;
+  if(this->realtime) this->start_time = std::chrono::steady_clock::now();
+}
+
+void Timer::restore(uint64_t remaining){
+  this->configure(this->memory->read_word(TIM_CFG));
+  this->deadline = *this->clock + remaining;
+  this->start_clock = *this->clock;
+  if(this->realtime) this->start_time = std::chrono::steady_clock::now();
+}
+
+void Timer::update(){
+  if(this->written.exchange(false)) this->configure(this->memory->read_word(TIM_CFG));
+}
+
+bool Timer::expired(){
+  if(*this->clock < this->deadline) return false;
+  this->deadline += this->period;
+  //a long stretch without checks (interrupts masked, blocked host) raises only one interrupt
+  if(this->deadline <= *this->clock) this->deadline = *this->clock + this->period;
+  return true;
+}
+
+void Timer::pace(){
+  if(!this->realtime) return;
+  auto virtual_elapsed = std::chrono::microseconds((*this->clock - this->start_clock) * 1000 / this->instructions_per_ms);
+  auto target = this->start_time + virtual_elapsed;
+  if(target > std::chrono::steady_clock::now()) std::this_thread::sleep_until(target);
+}
+
+//a write by hart 0 itself starts the period at the instruction that wrote it
+void Timer::mmio_written(uint32_t address, uint32_t size){
+  if(this->owner == std::thread::id() || this->owner == std::this_thread::get_id()) this->configure(this->memory->read_word(TIM_CFG));
+  else this->written.store(true);
+  __atomic_store_n(this->next_event, 0, __ATOMIC_RELAXED);
+}
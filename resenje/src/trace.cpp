@@ -0,0 +1,21 @@
+#include "../inc/emulator.hpp"
+#include "../inc/trace.hpp"
+#include "../inc/disassembler.hpp"
+
+void TextTrace::before(Emulator* e, const DecodedInstruction& d){
+  *e->output_file << "\n" << std::to_string(e->instructions_retired) << "\t";
+  e->print_register_temp();
+  *e->output_file << describe_instruction(d) << "\n";
+}
+
+void BinaryTrace::before(Emulator* e, const DecodedInstruction& d){
+  e->trace_writer->begin(e->current_address, d, e->context, e->memory);
+}
+
+void BinaryTrace::after(Emulator* e){
+  e->trace_writer->end(e->context, e->memory);
+}
+
+void ProfileTrace::before(Emulator* e, const DecodedInstruction& d){
+  e->profiler->count(e->current_address);
+}
@@ -0,0 +1,108 @@
+#include "../inc/traceDump.hpp"
+#include "../inc/disassembler.hpp"
+#include <sstream>
+#include <iomanip>
+
+TraceDump::TraceDump(const string& filename, ostream* output, bool registers){
+  this->input_file = fopen(filename.c_str(), "rb");
+  if(this->input_file == nullptr) throw ExceptionAlert("Trace file " + filename + " can not be opened.");
+  this->output = output;
+  this->registers = registers;
+  this->context = {};
+  this->index = 0;
+  this->check_header();
+  this->dump();
+}
+
+TraceDump::~TraceDump(){
+  fclose(this->input_file);
+}
+
+bool TraceDump::read_bytes(uint8_t* bytes, size_t n){
+  size_t read = fread(bytes, 1, n, this->input_file);
+  if(read == 0) return false;
+  if(read != n) throw ExceptionAlert("Trace file ends in the middle of a record.");
+  return true;
+}
+
+bool TraceDump::read32(uint32_t* v){
+  uint8_t b[4];
+  if(!this->read_bytes(b, 4)) return false;
+  *v = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+  return true;
+}
+
+void TraceDump::check_header(){
+  uint8_t magic[TraceFormat::MAGIC_SIZE];
+  uint32_t version;
+  if(!this->read_bytes(magic, TraceFormat::MAGIC_SIZE) || memcmp(magic, TraceFormat::MAGIC, TraceFormat::MAGIC_SIZE) != 0) throw ExceptionAlert("Input is not an emulator trace file.");
+  if(!this->read32(&version) || version != TraceFormat::VERSION) throw ExceptionAlert("Unsupported trace file version.");
+}
+
+static string hex(uint32_t v, int width){
+  std::stringstream stream;
+  stream << std::hex << std::setw(width) << std::setfill('0') << v;
+  return stream.str();
+}
+
+void TraceDump::print_registers(uint32_t pc){
+  *this->output << "\nREGISTERS\n";
+  *this->output << "Current address: 0x" << hex(pc, 2) << "\n";
+  for(int i = 0 ; i < 16 ; ++i) *this->output << "r" << std::to_string(i) << "=0x" << hex(this->context.registers[i], 2) << "\n";
+  for(int i = 0 ; i < 3 ; ++i) *this->output << "c" << std::to_string(i) << "=0x" << hex(this->context.status_registers[i], 2) << "\n";
+  *this->output << "\n";
+}
+
+void TraceDump::dump(){
+  uint32_t pc, raw, changed;
+  while(this->read32(&pc)){
+    uint8_t write_count;
+    if(!this->read32(&raw) || !this->read32(&changed) || !this->read_bytes(&write_count, 1)) throw ExceptionAlert("Trace file ends in the middle of a record.");
+
+    if(write_count == TraceFormat::RESET_MARKER){
+      this->context = {};
+      this->context.registers[0xF] = pc;
+      if(!this->registers) *this->output << "RESET pc <= 0x" << hex(pc, 8) << "\n";
+      continue;
+    }
+    //an interrupt taken before the instruction at pc, raw is the cause and status and pc were pushed
+    bool interrupt = write_count == TraceFormat::INTERRUPT_MARKER;
+    if(interrupt) write_count = 2;
+    else if(write_count > TraceFormat::MAX_WRITES) throw ExceptionAlert("Corrupted trace record.");
+
+    if(interrupt){
+      if(!this->registers) *this->output << "INTERRUPT cause " << std::to_string(raw) << " at 0x" << hex(pc, 8);
+    }
+    else{
+      //the emulator advances the pc before the instruction runs
+      this->context.registers[0xF] = pc + 4;
+      DecodedInstruction d = DecodedInstruction::decode(raw);
+      if(this->registers){
+        *this->output << "\n" << std::to_string(this->index) << "\t";
+        this->print_registers(pc);
+        *this->output << describe_instruction(d) << "\n";
+      }
+      else{
+        *this->output << std::to_string(this->index) << "\t" << hex(pc, 8) << "\t";
+        for(int i = 0 ; i < 4 ; ++i) *this->output << hex((raw >> (8 * i)) & 0xFF, 2) << " ";
+        *this->output << "\t" << describe_instruction(d);
+      }
+    }
+
+    for(uint32_t i = 0 ; i < TraceFormat::REGISTER_COUNT ; ++i){
+      if(!(changed & (1u << i))) continue;
+      uint32_t value;
+      if(!this->read32(&value)) throw ExceptionAlert("Trace file ends in the middle of a record.");
+      if(i < 16) this->context.registers[i] = value;
+      else this->context.status_registers[i - 16] = value;
+      if(!this->registers) *this->output << "\t" << (i < 16 ? "r" + std::to_string(i) : "c" + std::to_string(i - 16)) << "=0x" << hex(value, 8);
+    }
+    for(uint8_t i = 0 ; i < write_count ; ++i){
+      uint32_t address, value;
+      if(!this->read32(&address) || !this->read32(&value)) throw ExceptionAlert("Trace file ends in the middle of a record.");
+      if(!this->registers) *this->output << "\tmem[0x" << hex(address, 8) << "]=0x" << hex(value, 8);
+    }
+    if(!this->registers) *this->output << "\n";
+    if(!interrupt) ++this->index;
+  }
+}
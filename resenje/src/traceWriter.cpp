@@ -0,0 +1,111 @@
+#include "../inc/traceWriter.hpp"
+#include <chrono>
+
+TraceWriter::TraceWriter(const string& filename) : ring(RING_BITS){
+  this->file = fopen(filename.c_str(), "wb");
+  if(this->file == nullptr) throw ExceptionAlert("Trace file " + filename + " can not be opened.");
+  uint8_t header[TraceFormat::MAGIC_SIZE + 4];
+  memcpy(header, TraceFormat::MAGIC, TraceFormat::MAGIC_SIZE);
+  put32(header + TraceFormat::MAGIC_SIZE, TraceFormat::VERSION);
+  fwrite(header, 1, sizeof(header), this->file);
+  this->write_count = 0;
+  this->stopping.store(false);
+  this->writer = std::thread(&TraceWriter::drain, this);
+}
+
+TraceWriter::~TraceWriter(){
+  this->stopping.store(true, std::memory_order_release);
+  this->writer.join();
+  fclose(this->file);
+}
+
+//writer thread, empties the ring into the file until the emulator is done and nothing is left
+void TraceWriter::drain(){
+  while(true){
+    bool last = this->stopping.load(std::memory_order_acquire);
+    const uint8_t* bytes;
+    size_t n;
+    while((n = this->ring.peek(&bytes)) > 0){
+      fwrite(bytes, 1, n, this->file);
+      this->ring.consume(n);
+    }
+    if(last) break;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+}
+
+void TraceWriter::reset(uint32_t pc){
+  uint8_t record[TraceFormat::HEADER_SIZE];
+  uint8_t* p = put32(record, pc);
+  p = put32(p, 0);
+  p = put32(p, 0);
+  *p = TraceFormat::RESET_MARKER;
+  this->ring.write(record, sizeof(record));
+}
+
+void TraceWriter::begin(uint32_t pc, const DecodedInstruction& d, const CpuContext& c, const Memory* m){
+  this->before = c;
+  this->pc = pc;
+  this->raw = d.raw;
+
+  //addresses the instruction is going to store to, taken from the state before it runs
+  const uint32_t* r = c.registers;
+  this->write_count = 0;
+  switch(d.opcode){
+    case 0x1: //INT pushes status and pc
+      this->write_addresses[this->write_count++] = r[0xE] - 4;
+      this->write_addresses[this->write_count++] = r[0xE] - 8;
+      break;
+    case 0x2: //CALL pushes pc
+      if(d.mode <= 0x1) this->write_addresses[this->write_count++] = r[0xE] - 4;
+      break;
+    case 0x4: //XCHG with memory
+      if(d.mode == 0x1) this->write_addresses[this->write_count++] = r[d.b] + d.d;
+      break;
+    case 0x8:
+      if(d.mode == 0x0 || d.mode == 0x3) this->write_addresses[this->write_count++] = r[d.a] + r[d.b] + d.d;
+      else if(d.mode == 0x1) this->write_addresses[this->write_count++] = r[d.a] + d.d;
+      else if(d.mode == 0x2) this->write_addresses[this->write_count++] = m->read_word(r[d.a] + r[d.b] + d.d);
+      break;
+  }
+  this->marker = this->write_count;
+}
+
+void TraceWriter::begin_interrupt(uint32_t cause, const CpuContext& c){
+  this->before = c;
+  this->pc = c.registers[0xF];
+  this->raw = cause;
+  this->write_addresses[0] = c.registers[0xE] - 4;
+  this->write_addresses[1] = c.registers[0xE] - 8;
+  this->write_count = 2;
+  this->marker = TraceFormat::INTERRUPT_MARKER;
+}
+
+void TraceWriter::end(const CpuContext& c, const Memory* m){
+  uint8_t record[TraceFormat::MAX_RECORD_SIZE];
+  uint8_t* p = record + TraceFormat::HEADER_SIZE;
+
+  uint32_t changed = 0;
+  for(uint32_t i = 0 ; i < 16 ; ++i){
+    if(c.registers[i] != this->before.registers[i]){
+      changed |= 1u << i;
+      p = put32(p, c.registers[i]);
+    }
+  }
+  for(uint32_t i = 0 ; i < 3 ; ++i){
+    if(c.status_registers[i] != this->before.status_registers[i]){
+      changed |= 1u << (16 + i);
+      p = put32(p, c.status_registers[i]);
+    }
+  }
+  for(uint8_t i = 0 ; i < this->write_count ; ++i){
+    p = put32(p, this->write_addresses[i]);
+    p = put32(p, m->read_word(this->write_addresses[i]));
+  }
+
+  uint8_t* h = put32(record, this->pc);
+  h = put32(h, this->raw);
+  h = put32(h, changed);
+  *h = this->marker;
+  this->ring.write(record, p - record);
+}
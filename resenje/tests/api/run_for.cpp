@@ -0,0 +1,74 @@
+//runs the image given as the argument through the libemu interface, see makefile/api.sh
+//the guest is run unsliced, sliced by run_for and one step at a time on every core,
+//every way it has to halt after the same instructions with the same registers and terminal output
+#include "../../inc/libemu.hpp"
+#include <cstdio>
+
+struct Result{
+  uint64_t instructions;
+  CpuContext context;
+  string output;
+};
+
+static Result run(const string& filename, EmulatorOptions::Core core, uint64_t slice){
+  EmulatorOptions o;
+  o.detached = true;
+  o.core = core;
+  Emulator e(o);
+  e.load_file(filename);
+  e.check_entry();
+  e.reset();
+  e.send_input("hello");
+  //a slice of 0 steps the guest
+  if(slice == 0){
+    while(e.step());
+  }
+  else{
+    while(!e.is_finished() && e.run_for(slice) > 0);
+  }
+  return Result{e.get_instructions_retired(), e.get_context(), e.get_terminal_output()};
+}
+
+static bool same(const Result& a, const Result& b){
+  return a.instructions == b.instructions && a.output == b.output
+         && memcmp(a.context.registers, b.context.registers, sizeof(a.context.registers)) == 0
+         && memcmp(a.context.status_registers, b.context.status_registers, sizeof(a.context.status_registers)) == 0;
+}
+
+int main(int argc, char* argv[]){
+  if(argc != 2){
+    printf("usage: run_for image.hex\n");
+    return 2;
+  }
+  const pair<EmulatorOptions::Core, const char*> cores[] = {
+    {EmulatorOptions::THREADED, "threaded"}, {EmulatorOptions::BLOCK, "block"}, {EmulatorOptions::JIT, "jit"}
+  };
+  const uint64_t slices[] = {1, 7, 100, 5000, 0};
+  bool failed = false;
+  try{
+    for(const auto& core : cores){
+      Result whole = run(argv[1], core.first, UINT64_MAX);
+      if(whole.output != "hello"){
+        printf("%-20s %-10s failed, output \"%s\"\n", "unsliced", core.second, whole.output.c_str());
+        failed = true;
+      }
+      for(uint64_t slice : slices){
+        Result sliced = run(argv[1], core.first, slice);
+        string mode = slice == 0 ? string("step") : "run_for " + std::to_string(slice);
+        if(same(whole, sliced)){
+          printf("%-20s %-10s ok\n", mode.c_str(), core.second);
+        }
+        else{
+          printf("%-20s %-10s failed, %llu instructions and output \"%s\", unsliced %llu and \"%s\"\n", mode.c_str(), core.second,
+                 (unsigned long long)sliced.instructions, sliced.output.c_str(), (unsigned long long)whole.instructions, whole.output.c_str());
+          failed = true;
+        }
+      }
+    }
+  }
+  catch(ExceptionAlert& e){
+    printf("%s\n", e.get_message().c_str());
+    return 1;
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,44 @@
+# file: semihost_files.s
+# writes batch_semihost.txt with the semihosting device then reads it back into r8 and r9
+# a batch job gets ERROR for both since detached instances have no host files
+
+.global batch_start
+
+.section batch
+batch_start:
+    ld $0xFFFFFF30, %r1     # sh_cmd
+    ld $0xFFFFFF34, %r2     # sh_addr
+    ld $0xFFFFFF38, %r3     # sh_len
+    ld $0xFFFFFF3C, %r4     # sh_name
+    ld $0xFFFFFF44, %r5     # sh_result
+    ld $text, %r6
+    st %r6, [%r2]
+    ld $8, %r6
+    st %r6, [%r3]
+    ld $name, %r6
+    st %r6, [%r4]
+    ld $2, %r6
+    st %r6, [%r1]           # WRITE_FILE
+    ld [%r5], %r8
+    ld $back, %r6
+    st %r6, [%r2]
+    ld $3, %r6
+    st %r6, [%r1]           # READ_FILE from offset 0
+    ld [%r5], %r9
+    halt
+
+# "batch_semihost.txt"
+name:
+.word 1668571490
+.word 1702059880
+.word 1869113709
+.word 1949201523
+.word 29816
+# "written\n"
+text:
+.word 1953067639
+.word 175007092
+back:
+.word 0
+.word 0
+.end
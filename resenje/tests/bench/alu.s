@@ -0,0 +1,26 @@
+# file: alu.s
+# tight register arithmetic loop, no memory accesses
+
+.global bench_start
+
+.section bench
+bench_start:
+    ld $1000000, %r1    # iterations
+    ld $1, %r2
+    ld $0, %r3
+    ld $3, %r4
+    ld $1, %r5
+    ld $7, %r8
+loop:
+    add %r2, %r3        # r3 counts up
+    mul %r4, %r5        # r5 *= 3, wraps around
+    add %r3, %r5
+    div %r8, %r5        # r5 /= 7
+    not %r6
+    xchg %r6, %r7
+    add %r4, %r3        # r3 += 3
+    sub %r2, %r1
+    bne %r1, %r0, loop
+    halt
+
+.end
@@ -0,0 +1,34 @@
+# file: branches.s
+# branches, jumps and wide constants that are all fetched from the literal pool
+
+.global bench_start
+
+.section bench
+bench_start:
+    ld $200000, %r1     # iterations
+    ld $1, %r2
+loop:
+    ld $0x12345678, %r3
+    ld $0x9ABCDEF0, %r4
+    beq %r3, %r4, never
+    jmp hop1
+hop1:
+    ld $0x0F0F0F0F, %r5
+    bgt %r5, %r3, never
+    jmp hop2
+hop2:
+    ld $0x7FFFFFFF, %r6
+    bgt %r3, %r6, never
+    jmp hop3
+hop3:
+    ld $0x13579BDF, %r7
+    beq %r7, %r5, never
+    jmp hop4
+hop4:
+    sub %r2, %r1
+    bne %r1, %r0, loop
+    halt
+never:
+    halt
+
+.end
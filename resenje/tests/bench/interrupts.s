@@ -0,0 +1,26 @@
+# file: interrupts.s
+# storm of software interrupts, each one enters the handler and returns with iret
+
+.global bench_start
+
+.section bench
+bench_start:
+    ld $0xFFFFFEFE, %sp
+    ld $handler, %r1
+    csrwr %r1, %handler
+    ld $200000, %r1     # interrupts
+    ld $1, %r2
+loop:
+    int
+    sub %r2, %r1
+    bne %r1, %r0, loop
+    halt
+
+handler:
+    push %r3
+    csrrd %cause, %r3
+    add %r2, %r10       # interrupts taken
+    pop %r3
+    iret
+
+.end
@@ -0,0 +1,25 @@
+# file: memcpy.s
+# word by word copy of a 64KB buffer, repeated
+
+.global bench_start
+
+.section bench
+bench_start:
+    ld $64, %r6         # repetitions
+    ld $1, %r7
+    ld $4, %r5
+copy:
+    ld $0x50000000, %r1 # source
+    ld $0x60000000, %r2 # destination
+    ld $0x50010000, %r3 # end of the source
+word:
+    ld [%r1], %r4
+    st %r4, [%r2]
+    add %r5, %r1
+    add %r5, %r2
+    bne %r1, %r3, word
+    sub %r7, %r6
+    bne %r6, %r0, copy
+    halt
+
+.end
@@ -0,0 +1,36 @@
+# file: recursion.s
+# naive recursive fibonacci, every call is a call/ret pair with pushes and pops
+
+.global bench_start
+
+.section bench
+bench_start:
+    ld $0xFFFFFEFE, %sp
+    ld $25, %r1
+    call fib
+    halt
+
+# r2 <= fib(r1), r1 is preserved, r3 and r4 are clobbered
+fib:
+    ld $2, %r3
+    bgt %r3, %r1, fib_base
+    push %r1
+    ld $1, %r3
+    sub %r3, %r1
+    call fib
+    pop %r1
+    push %r2
+    push %r1
+    ld $2, %r3
+    sub %r3, %r1
+    call fib
+    pop %r1
+    pop %r4
+    add %r4, %r2
+    ret
+fib_base:
+    ld $0, %r2
+    add %r1, %r2
+    ret
+
+.end
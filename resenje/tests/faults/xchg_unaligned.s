@@ -0,0 +1,23 @@
+# file: xchg_unaligned.s
+# an atomic exchange that becomes unaligned after its block was hot enough to be compiled
+# expected: Atomic exchange needs a word aligned address.
+
+.global fault_start
+
+.section fault
+fault_start:
+    ld $word, %r1
+    ld $40, %r4         # iterations
+    ld $1, %r5
+loop:
+    xchg [%r1 + 0], %r2
+    sub %r5, %r4
+    bne %r4, %r0, loop
+    add %r5, %r1        # unaligned from now on
+    ld $1, %r4
+    jmp loop
+    halt
+
+word:
+.word 0
+.end
@@ -0,0 +1,33 @@
+# file: echo.s
+# echoes five characters taken in terminal interrupts, the timer is masked
+# so only the terminal input decides when the program goes on
+
+.global echo_start
+
+.section echo
+echo_start:
+    ld $0xFFFFFEFE, %sp
+    ld $handler, %r1
+    csrwr %r1, %handler
+    # timer masked
+    ld $1, %r1
+    csrwr %r1, %status
+    ld $0, %r6
+    ld $5, %r7
+wait:
+    bne %r6, %r7, wait
+    halt
+handler:
+    push %r1
+    push %r2
+    ld $0xFFFFFF04, %r2     # term_in
+    ld [%r2], %r1
+    ld $0xFFFFFF00, %r2     # term_out
+    st %r1, [%r2]
+    add %r1, %r8
+    ld $1, %r2
+    add %r2, %r6
+    pop %r2
+    pop %r1
+    iret
+.end